@@ -0,0 +1,250 @@
+#pragma once
+
+#include "AABB.hpp"
+#include "../core/utils.hpp"
+#include "../core/ray.hpp"
+#include "../core/numa.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+/**
+ * @brief One node of a FlatBVH, 32 bytes.
+ * Nodes are stored in depth-first order: an interior node's first child directly follows it.
+ */
+struct FlatBVHNode {
+    glm::vec3 bounds_min;
+    int32_t offset;   // Leaf: first primitive. Interior: index of the second child.
+    glm::vec3 bounds_max;
+    uint16_t count;   // Number of primitives in a leaf, 0 for interior nodes
+    uint16_t axis;    // Split axis of an interior node (front-to-back traversal order)
+};
+
+/**
+ * @brief Bounding volume hierarchy over an indexed primitive array, stored as a flat node vector.
+ *
+ * Unlike BVHNode it holds no pointers, so it can be written to disk and read back verbatim, and
+ * traversal is an explicit stack loop instead of virtual recursion. Primitives are referenced as
+ * contiguous ranges: the builder returns the order in which the caller must store them.
+ * Splits are chosen by a binned surface area heuristic along the widest centroid axis (falling back
+ * to the median when the bins cannot separate the primitives), so outliers such as a huge ground
+ * primitive are isolated near the root. The build is deterministic: the same input gives the same tree.
+ */
+class FlatBVH {
+public:
+    NumaVector<FlatBVHNode> nodes; // Large trees are interleaved over the NUMA nodes, on huge pages
+
+    bool empty() const { return nodes.empty(); }
+
+    AABB bounds() const {
+        if (nodes.empty()) return AABB();
+        return AABB(nodes[0].bounds_min, nodes[0].bounds_max);
+    }
+
+    /**
+     * @brief Build over the given primitive bounds.
+     * @param order [out] order[i] is the original index of the primitive to store at position i.
+     */
+    void build(const std::vector<AABB>& prim_bounds, std::vector<uint32_t>& order) {
+        nodes.clear();
+        order.resize(prim_bounds.size());
+        std::iota(order.begin(), order.end(), 0u);
+        if (prim_bounds.empty()) return;
+
+        std::vector<glm::vec3> centroids(prim_bounds.size());
+        for (size_t i = 0; i < prim_bounds.size(); ++i)
+            centroids[i] = 0.5f * (prim_bounds[i].min_point() + prim_bounds[i].max_point());
+
+        nodes.reserve(2 * prim_bounds.size() / FLAT_BVH_LEAF_SIZE + 1);
+        build_recursive(prim_bounds, centroids, order, 0, static_cast<uint32_t>(order.size()), 0);
+    }
+
+    /**
+     * @brief Recompute all bounds bottom-up after the primitives moved (topology is kept).
+     * @param prim_bounds Callable returning the AABB of the primitive stored at a given position.
+     */
+    template <typename BoundsFn>
+    void refit(BoundsFn&& prim_bounds) {
+        // Children always come after their parent, so a reverse sweep sees them first
+        for (int i = static_cast<int>(nodes.size()) - 1; i >= 0; --i) {
+            FlatBVHNode& node = nodes[i];
+            AABB box;
+            if (node.count > 0) {
+                box = prim_bounds(node.offset);
+                for (int k = 1; k < node.count; ++k) box = surrounding_box(box, prim_bounds(node.offset + k));
+            } else {
+                const FlatBVHNode& a = nodes[i + 1];
+                const FlatBVHNode& b = nodes[node.offset];
+                box = surrounding_box(AABB(a.bounds_min, a.bounds_max), AABB(b.bounds_min, b.bounds_max));
+            }
+            node.bounds_min = box.min_point();
+            node.bounds_max = box.max_point();
+        }
+    }
+
+    /**
+     * @brief Closest hit traversal, front to back.
+     * @param hit_prim Callable (int prim, float& t_max) -> bool that intersects one primitive,
+     *                 fills the caller's hit record and lowers t_max when it finds a closer hit.
+     * @param t_max [in/out] Shrinks to the closest hit distance.
+     */
+    template <typename HitFn>
+    bool intersect(const Ray& r, float t_min, float& t_max, HitFn&& hit_prim) const {
+        return intersect_leaves(r, t_min, t_max, [&](int first, int count, float& closest) {
+            bool hit = false;
+            for (int k = 0; k < count; ++k) {
+                if (hit_prim(first + k, closest)) hit = true;
+            }
+            return hit;
+        });
+    }
+
+    /**
+     * @brief Same traversal, but hands whole leaves to the caller so it can test them as one batch.
+     * @param hit_leaf Callable (int first, int count, float& t_max) -> bool over the primitives
+     *                 [first, first + count), count <= FLAT_BVH_LEAF_SIZE.
+     */
+    template <typename LeafFn>
+    bool intersect_leaves(const Ray& r, float t_min, float& t_max, LeafFn&& hit_leaf) const {
+        if (nodes.empty()) return false;
+
+        const glm::vec3 origin = r.origin();
+        const glm::vec3 inv_dir = r.inv_direction();
+        const bool dir_negative[3] = {inv_dir.x < 0.0f, inv_dir.y < 0.0f, inv_dir.z < 0.0f};
+
+        int stack[FLAT_BVH_STACK_SIZE];
+        int stack_size = 0;
+        int current = 0;
+        bool hit_anything = false;
+
+        for (;;) {
+            const FlatBVHNode& node = nodes[current];
+            if (hit_box(node, origin, inv_dir, t_min, t_max)) {
+                if (node.count > 0) {
+                    if (hit_leaf(node.offset, int(node.count), t_max)) hit_anything = true;
+                } else {
+                    // Visit the child on the near side of the split first
+                    if (dir_negative[node.axis]) {
+                        stack[stack_size++] = current + 1;
+                        current = node.offset;
+                    } else {
+                        stack[stack_size++] = node.offset;
+                        current = current + 1;
+                    }
+                    continue;
+                }
+            }
+            if (stack_size == 0) break;
+            current = stack[--stack_size];
+        }
+        return hit_anything;
+    }
+
+private:
+    static bool hit_box(const FlatBVHNode& node, const glm::vec3& origin, const glm::vec3& inv_dir, float t_min, float t_max) {
+        const glm::vec3 t0 = (node.bounds_min - origin) * inv_dir;
+        const glm::vec3 t1 = (node.bounds_max - origin) * inv_dir;
+        const glm::vec3 t_smaller = glm::min(t0, t1);
+        const glm::vec3 t_bigger = glm::max(t0, t1);
+        const float t_enter = std::max({t_min, t_smaller.x, t_smaller.y, t_smaller.z});
+        const float t_exit = std::min({t_max, t_bigger.x, t_bigger.y, t_bigger.z});
+        return t_enter <= t_exit;
+    }
+
+    static float half_area(const AABB& box) {
+        glm::vec3 d = box.max_point() - box.min_point();
+        return d.x * d.y + d.y * d.z + d.z * d.x;
+    }
+
+    /**
+     * @brief Partition [start, end) at the cheapest of FLAT_BVH_SAH_BINS - 1 bin boundaries.
+     * @return The first index of the second half (start or end if no useful split exists).
+     */
+    static uint32_t sah_split(const std::vector<AABB>& prim_bounds, const std::vector<glm::vec3>& centroids,
+                              std::vector<uint32_t>& order, uint32_t start, uint32_t end,
+                              int axis, float c_min, float c_extent) {
+        if (!(c_extent > 0.0f)) return start;
+
+        const int bins = FLAT_BVH_SAH_BINS;
+        const float scale = bins / c_extent;
+        auto bin_of = [&](uint32_t prim) {
+            return std::min(bins - 1, static_cast<int>((centroids[prim][axis] - c_min) * scale));
+        };
+
+        AABB bin_box[FLAT_BVH_SAH_BINS];
+        int bin_count[FLAT_BVH_SAH_BINS] = {};
+        for (uint32_t i = start; i < end; ++i) {
+            int b = bin_of(order[i]);
+            bin_box[b] = bin_count[b] ? surrounding_box(bin_box[b], prim_bounds[order[i]]) : prim_bounds[order[i]];
+            ++bin_count[b];
+        }
+
+        // Sweep from the right to get the cost of every suffix, then from the left to evaluate splits
+        float right_cost[FLAT_BVH_SAH_BINS] = {};
+        AABB acc;
+        int count = 0;
+        for (int b = bins - 1; b > 0; --b) {
+            if (bin_count[b]) { acc = count ? surrounding_box(acc, bin_box[b]) : bin_box[b]; count += bin_count[b]; }
+            right_cost[b] = count ? count * half_area(acc) : 0.0f;
+        }
+
+        int best = -1;
+        float best_cost = Infinity;
+        acc = AABB();
+        count = 0;
+        for (int b = 0; b < bins - 1; ++b) {
+            if (bin_count[b]) { acc = count ? surrounding_box(acc, bin_box[b]) : bin_box[b]; count += bin_count[b]; }
+            if (count == 0 || count == int(end - start)) continue;
+            float cost = count * half_area(acc) + right_cost[b + 1];
+            if (cost < best_cost) { best_cost = cost; best = b; }
+        }
+        if (best < 0) return start;
+
+        auto second = std::partition(order.begin() + start, order.begin() + end,
+                                     [&](uint32_t prim) { return bin_of(prim) <= best; });
+        return static_cast<uint32_t>(second - order.begin());
+    }
+
+    int build_recursive(const std::vector<AABB>& prim_bounds, const std::vector<glm::vec3>& centroids,
+                        std::vector<uint32_t>& order, uint32_t start, uint32_t end, int depth) {
+        int index = static_cast<int>(nodes.size());
+        nodes.emplace_back();
+
+        AABB box = prim_bounds[order[start]];
+        glm::vec3 c_min = centroids[order[start]], c_max = c_min;
+        for (uint32_t i = start + 1; i < end; ++i) {
+            box = surrounding_box(box, prim_bounds[order[i]]);
+            c_min = glm::min(c_min, centroids[order[i]]);
+            c_max = glm::max(c_max, centroids[order[i]]);
+        }
+        nodes[index].bounds_min = box.min_point();
+        nodes[index].bounds_max = box.max_point();
+
+        uint32_t span = end - start;
+        if (span <= uint32_t(FLAT_BVH_LEAF_SIZE)) {
+            nodes[index].offset = static_cast<int32_t>(start);
+            nodes[index].count = static_cast<uint16_t>(span);
+            nodes[index].axis = 0;
+            return index;
+        }
+
+        glm::vec3 extent = c_max - c_min;
+        int axis = (extent.x > extent.y && extent.x > extent.z) ? 0 : (extent.y > extent.z ? 1 : 2);
+        uint32_t mid = (depth < FLAT_BVH_SAH_MAX_DEPTH)
+            ? sah_split(prim_bounds, centroids, order, start, end, axis, c_min[axis], extent[axis]) : start;
+        if (mid == start || mid == end) {
+            // Median split (coincident centroids still split evenly)
+            mid = start + span / 2;
+            std::nth_element(order.begin() + start, order.begin() + mid, order.begin() + end,
+                             [&](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+        }
+
+        build_recursive(prim_bounds, centroids, order, start, mid, depth + 1);
+        int second = build_recursive(prim_bounds, centroids, order, mid, end, depth + 1);
+        nodes[index].offset = second;
+        nodes[index].count = 0;
+        nodes[index].axis = static_cast<uint16_t>(axis);
+        return index;
+    }
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../core/photon.hpp"
+#include "../core/numa.hpp"
 #include <vector>
 #include <algorithm>
 #include <iostream>
@@ -79,7 +80,7 @@ public:
     size_t size() const { return photons.size(); }
 
 private:
-    std::vector<Photon> photons;
+    NumaVector<Photon> photons; // Read by every thread: interleaved over the NUMA nodes
 
     /**
      * @brief Recursively balances the tree segment.
@@ -0,0 +1,351 @@
+#pragma once
+
+#include "flat_bvh.hpp"
+#include "../object/sphere.hpp"
+#include "../object/moving_sphere.hpp"
+#include "../object/disk.hpp"
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PRIMITIVE_SET_SSE 1
+#endif
+
+/**
+ * @brief Ray / primitive kernels over structure-of-arrays batches, 4 primitives per call.
+ * A batch is the same-type run of one FlatBVH leaf: slots [first, first + count) with count <= 4. The arrays carry
+ * 3 padding entries past the end so the 4-wide loads never leave the allocation; unused lanes are masked.
+ */
+namespace primitive_kernels {
+
+const int LANES = 4;
+static_assert(FLAT_BVH_LEAF_SIZE <= LANES, "A FlatBVH leaf must fit in one SIMD batch");
+
+/**
+ * @brief Pick the closest lane that hit.
+ * @return Index of the lane (-1 if none), 't' receives its distance.
+ */
+inline int closest_lane(const float* t_lane, int hit_mask, float& t) {
+    int best = -1;
+    for (int k = 0; k < LANES; ++k) {
+        if ((hit_mask & (1 << k)) && (best < 0 || t_lane[k] < t)) {
+            best = k;
+            t = t_lane[k];
+        }
+    }
+    return best;
+}
+
+#ifdef PRIMITIVE_SET_SSE
+inline __m128 lane_mask(int count) {
+    return _mm_cmplt_ps(_mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f), _mm_set1_ps(float(count)));
+}
+
+/**
+ * @brief Robust sphere roots (same formulation as intersect_sphere) for 4 centers at once.
+ * @return Bit mask of lanes with a root in [t_min, t_max], roots in 't_out'.
+ */
+inline int spheres4(const Ray& r, __m128 cx, __m128 cy, __m128 cz, __m128 radius, int count,
+                    float t_min, float t_max, float* t_out) {
+    const glm::vec3 o = r.origin();
+    const glm::vec3 d = r.direction();
+    const __m128 dx = _mm_set1_ps(d.x), dy = _mm_set1_ps(d.y), dz = _mm_set1_ps(d.z);
+    const float a = glm::dot(d, d);
+    const __m128 va = _mm_set1_ps(a), inv_a = _mm_set1_ps(1.0f / a);
+
+    __m128 fx = _mm_sub_ps(_mm_set1_ps(o.x), cx);
+    __m128 fy = _mm_sub_ps(_mm_set1_ps(o.y), cy);
+    __m128 fz = _mm_sub_ps(_mm_set1_ps(o.z), cz);
+    __m128 b = _mm_sub_ps(_mm_setzero_ps(),
+                          _mm_add_ps(_mm_add_ps(_mm_mul_ps(fx, dx), _mm_mul_ps(fy, dy)), _mm_mul_ps(fz, dz)));
+    __m128 ba = _mm_mul_ps(b, inv_a);
+    __m128 lx = _mm_add_ps(fx, _mm_mul_ps(ba, dx));
+    __m128 ly = _mm_add_ps(fy, _mm_mul_ps(ba, dy));
+    __m128 lz = _mm_add_ps(fz, _mm_mul_ps(ba, dz));
+    __m128 r2 = _mm_mul_ps(radius, radius);
+    __m128 disc = _mm_sub_ps(r2, _mm_add_ps(_mm_add_ps(_mm_mul_ps(lx, lx), _mm_mul_ps(ly, ly)), _mm_mul_ps(lz, lz)));
+    __m128 c = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(fx, fx), _mm_mul_ps(fy, fy)), _mm_mul_ps(fz, fz)), r2);
+
+    const __m128 sign_mask = _mm_set1_ps(-0.0f);
+    __m128 root = _mm_sqrt_ps(_mm_max_ps(_mm_mul_ps(va, disc), _mm_setzero_ps()));
+    __m128 q = _mm_add_ps(b, _mm_or_ps(root, _mm_and_ps(b, sign_mask)));
+    __m128 t0 = _mm_div_ps(c, q);
+    __m128 t1 = _mm_mul_ps(q, inv_a);
+    __m128 t_near = _mm_min_ps(t0, t1);
+    __m128 t_far = _mm_max_ps(t0, t1);
+
+    const __m128 lo = _mm_set1_ps(t_min), hi = _mm_set1_ps(t_max);
+    __m128 near_ok = _mm_and_ps(_mm_cmpge_ps(t_near, lo), _mm_cmple_ps(t_near, hi));
+    __m128 far_ok = _mm_and_ps(_mm_cmpge_ps(t_far, lo), _mm_cmple_ps(t_far, hi));
+    __m128 t = _mm_or_ps(_mm_and_ps(near_ok, t_near), _mm_andnot_ps(near_ok, t_far));
+    __m128 hit = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(disc, _mm_setzero_ps()), lane_mask(count)), _mm_or_ps(near_ok, far_ok));
+
+    _mm_storeu_ps(t_out, t);
+    return _mm_movemask_ps(hit);
+}
+#endif
+
+} // namespace primitive_kernels
+
+/**
+ * @brief Analytic shapes (spheres, moving spheres, disks) stored by type in structure-of-arrays form.
+ *
+ * One FlatBVH spans all shapes; its leaves hold (type, index) references sorted by type, and the
+ * per-type arrays are laid out so that each same-type run of a leaf is a contiguous range there.
+ * A leaf is thus tested as at most one 4-wide batch per type instead of up to four virtual
+ * intersect() calls on separately allocated objects. Only the closest primitive fills the hit
+ * record, through the shape's own fill_record(), so shading and MIS see exactly the same record
+ * as before (rec.object is still the original shape). The set is a single Object in the scene BVH.
+ */
+class PrimitiveSet : public Object {
+public:
+    /**
+     * @brief Whether 'obj' can be stored in a PrimitiveSet.
+     */
+    static bool accepts(const Object& obj) {
+        return dynamic_cast<const Sphere*>(&obj) || dynamic_cast<const MovingSphere*>(&obj) || dynamic_cast<const Disk*>(&obj);
+    }
+
+    /**
+     * @param shapes Objects for which accepts() is true; the set keeps them alive.
+     * @param time0, time1 Shutter interval, used to bound moving spheres.
+     */
+    PrimitiveSet(const std::vector<std::shared_ptr<Object>>& shapes, float time0, float time1) : owned(shapes) {
+        std::vector<AABB> bounds(shapes.size());
+        for (size_t i = 0; i < shapes.size(); ++i) shapes[i]->bounding_box(time0, time1, bounds[i]);
+        std::vector<uint32_t> order;
+        bvh.build(bounds, order);
+        if (bvh.empty()) return;
+        box = bvh.bounds();
+
+        // Group every leaf by type, then hand out per-type slots in leaf order
+        for (const FlatBVHNode& node : bvh.nodes) {
+            if (node.count == 0) continue;
+            std::stable_sort(order.begin() + node.offset, order.begin() + node.offset + node.count,
+                             [&](uint32_t a, uint32_t b) { return type_of(*shapes[a]) < type_of(*shapes[b]); });
+        }
+        refs.reserve(order.size());
+        for (uint32_t i : order) {
+            const Object* obj = shapes[i].get();
+            switch (type_of(*obj)) {
+            case Type::Sphere:       refs.push_back(make_ref(Type::Sphere, spheres.add(static_cast<const Sphere*>(obj)))); break;
+            case Type::MovingSphere: refs.push_back(make_ref(Type::MovingSphere, moving_spheres.add(static_cast<const MovingSphere*>(obj)))); break;
+            case Type::Disk:         refs.push_back(make_ref(Type::Disk, disks.add(static_cast<const Disk*>(obj)))); break;
+            }
+        }
+        spheres.pad_arrays();
+        moving_spheres.pad_arrays();
+        disks.pad_arrays();
+    }
+
+    size_t size() const { return owned.size(); }
+
+    virtual bool intersect(const Ray& r, float t_min, float t_max, HitRecord& rec) const override {
+        return bvh.intersect_leaves(r, t_min, t_max, [&](int first, int count, float& closest) {
+            bool hit = false;
+            for (int k = first, end = first + count; k < end;) {
+                // One batch per same-type run; its slots are consecutive in the type's arrays
+                Type type = ref_type(refs[k]);
+                int index = ref_index(refs[k]);
+                int run = 1;
+                while (k + run < end && ref_type(refs[k + run]) == type) ++run;
+                switch (type) {
+                case Type::Sphere:       hit |= spheres.intersect(r, index, run, t_min, closest, rec); break;
+                case Type::MovingSphere: hit |= moving_spheres.intersect(r, index, run, t_min, closest, rec); break;
+                case Type::Disk:         hit |= disks.intersect(r, index, run, t_min, closest, rec); break;
+                }
+                k += run;
+            }
+            return hit;
+        });
+    }
+
+    virtual bool bounding_box(float time0, float time1, AABB& output_box) const override {
+        output_box = box;
+        return !owned.empty();
+    }
+
+    // Like BVHNode, the set is only an acceleration structure: lights keep referencing the shapes themselves.
+    virtual Material* get_material() const override { return nullptr; }
+    virtual float pdf_value(const glm::vec3& origin, const glm::vec3& v) const override { return 0.0f; }
+    virtual glm::vec3 random_pointing_vector(const glm::vec3& origin) const override { return glm::vec3(0.0f); }
+    virtual void sample_surface(glm::vec3& pos, glm::vec3& normal, float& area) const override { area = 0.0f; }
+
+private:
+    enum class Type : uint32_t { Sphere, MovingSphere, Disk };
+
+    static const uint32_t TYPE_SHIFT = 30;
+    static const uint32_t INDEX_MASK = (1u << TYPE_SHIFT) - 1;
+
+    static Type type_of(const Object& obj) {
+        if (dynamic_cast<const Sphere*>(&obj)) return Type::Sphere;
+        if (dynamic_cast<const MovingSphere*>(&obj)) return Type::MovingSphere;
+        return Type::Disk;
+    }
+    static uint32_t make_ref(Type type, int index) { return (static_cast<uint32_t>(type) << TYPE_SHIFT) | uint32_t(index); }
+    static Type ref_type(uint32_t ref) { return static_cast<Type>(ref >> TYPE_SHIFT); }
+    static int ref_index(uint32_t ref) { return static_cast<int>(ref & INDEX_MASK); }
+
+    static void pad(std::vector<float>& v) { v.resize(v.size() + primitive_kernels::LANES - 1, 0.0f); }
+
+    struct SphereStore {
+        std::vector<float> cx, cy, cz, radius;
+        std::vector<const Sphere*> shape;
+
+        int add(const Sphere* s) {
+            cx.push_back(s->center.x); cy.push_back(s->center.y); cz.push_back(s->center.z);
+            radius.push_back(s->radius);
+            shape.push_back(s);
+            return static_cast<int>(shape.size()) - 1;
+        }
+
+        void pad_arrays() { for (auto* v : {&cx, &cy, &cz, &radius}) pad(*v); }
+
+        bool intersect(const Ray& r, int first, int count, float t_min, float& closest, HitRecord& rec) const {
+            float t = closest;
+            int best = -1;
+#ifdef PRIMITIVE_SET_SSE
+            float t_lane[primitive_kernels::LANES];
+            int mask = primitive_kernels::spheres4(r, _mm_loadu_ps(&cx[first]), _mm_loadu_ps(&cy[first]), _mm_loadu_ps(&cz[first]),
+                                                   _mm_loadu_ps(&radius[first]), count, t_min, closest, t_lane);
+            int lane = primitive_kernels::closest_lane(t_lane, mask, t);
+            if (lane >= 0) best = first + lane;
+#else
+            for (int i = first; i < first + count; ++i) {
+                float ti;
+                if (intersect_sphere(r.origin(), r.direction(), glm::vec3(cx[i], cy[i], cz[i]), radius[i], t_min, t, ti)) {
+                    t = ti;
+                    best = i;
+                }
+            }
+#endif
+            if (best < 0) return false;
+            closest = t;
+            shape[best]->fill_record(r, t, rec);
+            return true;
+        }
+    };
+
+    struct MovingSphereStore {
+        std::vector<float> cx, cy, cz;   // Center at 'start'
+        std::vector<float> vx, vy, vz;   // Velocity per unit time
+        std::vector<float> start, radius;
+        std::vector<const MovingSphere*> shape;
+
+        int add(const MovingSphere* s) {
+            glm::vec3 velocity = (s->center1 - s->center0) / (s->time1 - s->time0);
+            cx.push_back(s->center0.x); cy.push_back(s->center0.y); cz.push_back(s->center0.z);
+            vx.push_back(velocity.x); vy.push_back(velocity.y); vz.push_back(velocity.z);
+            start.push_back(s->time0);
+            radius.push_back(s->radius);
+            shape.push_back(s);
+            return static_cast<int>(shape.size()) - 1;
+        }
+
+        void pad_arrays() { for (auto* v : {&cx, &cy, &cz, &vx, &vy, &vz, &start, &radius}) pad(*v); }
+
+        bool intersect(const Ray& r, int first, int count, float t_min, float& closest, HitRecord& rec) const {
+            const float time = r.time();
+            float t = closest;
+            int best = -1;
+#ifdef PRIMITIVE_SET_SSE
+            __m128 dt = _mm_sub_ps(_mm_set1_ps(time), _mm_loadu_ps(&start[first]));
+            __m128 mx = _mm_add_ps(_mm_loadu_ps(&cx[first]), _mm_mul_ps(_mm_loadu_ps(&vx[first]), dt));
+            __m128 my = _mm_add_ps(_mm_loadu_ps(&cy[first]), _mm_mul_ps(_mm_loadu_ps(&vy[first]), dt));
+            __m128 mz = _mm_add_ps(_mm_loadu_ps(&cz[first]), _mm_mul_ps(_mm_loadu_ps(&vz[first]), dt));
+            float t_lane[primitive_kernels::LANES];
+            int mask = primitive_kernels::spheres4(r, mx, my, mz, _mm_loadu_ps(&radius[first]), count, t_min, closest, t_lane);
+            int lane = primitive_kernels::closest_lane(t_lane, mask, t);
+            if (lane >= 0) best = first + lane;
+#else
+            for (int i = first; i < first + count; ++i) {
+                float ti;
+                if (intersect_sphere(r.origin(), r.direction(), center(i, time), radius[i], t_min, t, ti)) {
+                    t = ti;
+                    best = i;
+                }
+            }
+#endif
+            if (best < 0) return false;
+            closest = t;
+            shape[best]->fill_record(r, t, center(best, time), rec);
+            return true;
+        }
+
+        glm::vec3 center(int i, float time) const {
+            float dt = time - start[i];
+            return glm::vec3(cx[i] + vx[i] * dt, cy[i] + vy[i] * dt, cz[i] + vz[i] * dt);
+        }
+    };
+
+    struct DiskStore {
+        std::vector<float> cx, cy, cz, nx, ny, nz, radius2;
+        std::vector<const Disk*> shape;
+
+        int add(const Disk* s) {
+            cx.push_back(s->center.x); cy.push_back(s->center.y); cz.push_back(s->center.z);
+            nx.push_back(s->normal.x); ny.push_back(s->normal.y); nz.push_back(s->normal.z);
+            radius2.push_back(s->radius * s->radius);
+            shape.push_back(s);
+            return static_cast<int>(shape.size()) - 1;
+        }
+
+        void pad_arrays() { for (auto* v : {&cx, &cy, &cz, &nx, &ny, &nz, &radius2}) pad(*v); }
+
+        bool intersect(const Ray& r, int first, int count, float t_min, float& closest, HitRecord& rec) const {
+            float t = closest;
+            int best = -1;
+#ifdef PRIMITIVE_SET_SSE
+            const glm::vec3 o = r.origin();
+            const glm::vec3 d = r.direction();
+            __m128 pnx = _mm_loadu_ps(&nx[first]), pny = _mm_loadu_ps(&ny[first]), pnz = _mm_loadu_ps(&nz[first]);
+            __m128 ox = _mm_sub_ps(_mm_loadu_ps(&cx[first]), _mm_set1_ps(o.x));
+            __m128 oy = _mm_sub_ps(_mm_loadu_ps(&cy[first]), _mm_set1_ps(o.y));
+            __m128 oz = _mm_sub_ps(_mm_loadu_ps(&cz[first]), _mm_set1_ps(o.z));
+            __m128 denom = _mm_add_ps(_mm_add_ps(_mm_mul_ps(pnx, _mm_set1_ps(d.x)), _mm_mul_ps(pny, _mm_set1_ps(d.y))),
+                                      _mm_mul_ps(pnz, _mm_set1_ps(d.z)));
+            __m128 num = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ox, pnx), _mm_mul_ps(oy, pny)), _mm_mul_ps(oz, pnz));
+            __m128 tv = _mm_div_ps(num, denom);
+
+            // Offset of the plane hit from the center: o + t d - c
+            __m128 px = _mm_sub_ps(_mm_mul_ps(tv, _mm_set1_ps(d.x)), ox);
+            __m128 py = _mm_sub_ps(_mm_mul_ps(tv, _mm_set1_ps(d.y)), oy);
+            __m128 pz = _mm_sub_ps(_mm_mul_ps(tv, _mm_set1_ps(d.z)), oz);
+            __m128 dist2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, px), _mm_mul_ps(py, py)), _mm_mul_ps(pz, pz));
+
+            __m128 abs_denom = _mm_andnot_ps(_mm_set1_ps(-0.0f), denom);
+            __m128 hit = _mm_and_ps(_mm_cmpge_ps(abs_denom, _mm_set1_ps(EPSILON)), primitive_kernels::lane_mask(count));
+            hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpge_ps(tv, _mm_set1_ps(t_min)), _mm_cmple_ps(tv, _mm_set1_ps(closest))));
+            hit = _mm_and_ps(hit, _mm_cmple_ps(dist2, _mm_loadu_ps(&radius2[first])));
+
+            float t_lane[primitive_kernels::LANES];
+            _mm_storeu_ps(t_lane, tv);
+            int lane = primitive_kernels::closest_lane(t_lane, _mm_movemask_ps(hit), t);
+            if (lane >= 0) best = first + lane;
+#else
+            HitRecord probe;
+            for (int i = first; i < first + count; ++i) {
+                if (shape[i]->intersect(r, t_min, t, probe)) {
+                    t = probe.t;
+                    best = i;
+                }
+            }
+#endif
+            if (best < 0) return false;
+            closest = t;
+            shape[best]->fill_record(r, t, rec);
+            return true;
+        }
+    };
+
+    std::vector<std::shared_ptr<Object>> owned;
+    FlatBVH bvh;
+    std::vector<uint32_t> refs; // (type, slot) per BVH primitive, same-type runs within each leaf
+    SphereStore spheres;
+    MovingSphereStore moving_spheres;
+    DiskStore disks;
+    AABB box;
+};
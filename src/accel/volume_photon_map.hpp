@@ -0,0 +1,101 @@
+#pragma once
+
+#include "flat_bvh.hpp"
+#include "kdtree.hpp"
+#include "../core/photon.hpp"
+#include "../core/utils.hpp"
+#include <omp.h>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+/**
+ * @brief Photons stored at scattering events inside participating media, for beam radiance estimates.
+ *
+ * Each photon is a sphere whose radius reaches its k-th nearest volume photon (clamped to a maximum),
+ * so the kernel is wide where photons are sparse and tight in bright regions. A FlatBVH over the
+ * spheres answers "which photons does this ray segment pass through" in one traversal, which is the
+ * query of the beam radiance estimate (Jarosz et al. 2008).
+ */
+class VolumePhotonMap {
+public:
+    void add_photon(const Photon& p) { photons.push_back(p); }
+
+    bool empty() const { return photons.empty(); }
+    size_t size() const { return photons.size(); }
+
+    /**
+     * @brief Assign the kNN radii and build the sphere hierarchy.
+     * @param k Neighbours used to size each photon's sphere.
+     * @param max_radius Upper bound of the sphere radius.
+     */
+    void build(int k, float max_radius) {
+        if (photons.empty()) return;
+
+        // Radii from a kd-tree over the same photons
+        PhotonMap knn;
+        for (const auto& p : photons) knn.add_photon(p);
+        knn.build();
+
+        std::vector<float> r2(photons.size());
+        #pragma omp parallel
+        {
+            std::vector<NearPhoton> neighbors;
+            #pragma omp for schedule(dynamic, 1024)
+            for (long long i = 0; i < (long long)photons.size(); ++i) {
+                float dist_sq = max_radius * max_radius;
+                knn.find_knn(photons[i].p, k, neighbors, dist_sq);
+                r2[i] = dist_sq > 0.0f ? dist_sq : max_radius * max_radius;
+            }
+        }
+
+        std::vector<AABB> bounds(photons.size());
+        for (size_t i = 0; i < photons.size(); ++i) {
+            const glm::vec3 extent(std::sqrt(r2[i]));
+            bounds[i] = AABB(photons[i].p - extent, photons[i].p + extent);
+        }
+
+        std::vector<uint32_t> order;
+        bvh.build(bounds, order);
+
+        NumaVector<Photon> sorted(photons.size(), photons.get_allocator());
+        radius_sq.resize(photons.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            sorted[i] = photons[order[i]];
+            radius_sq[i] = r2[order[i]];
+        }
+        photons.swap(sorted);
+        std::cout << "[VolumePhotonMap] Built with " << photons.size() << " photons." << std::endl;
+    }
+
+    /**
+     * @brief Visit every photon sphere pierced by r over [0, t_max].
+     * @param fn Callable (const Photon&, float t, float kernel): t is the ray parameter closest to the
+     *           photon, kernel the normalized 2D (biweight) kernel at the photon's distance to the ray.
+     */
+    template <typename Fn>
+    void beam_query(const Ray& r, float t_max, Fn&& fn) const {
+        const glm::vec3 d = r.direction();
+        const float inv_len_sq = 1.0f / glm::dot(d, d);
+        float t_far = t_max;
+        bvh.intersect(r, 0.0f, t_far, [&](int i, float&) {
+            const glm::vec3 op = photons[i].p - r.origin();
+            const float t = glm::dot(op, d) * inv_len_sq;
+            if (t < 0.0f || t > t_max) return false;
+
+            const glm::vec3 offset = op - t * d;
+            const float dist_sq = glm::dot(offset, offset);
+            if (dist_sq >= radius_sq[i]) return false;
+
+            // Silverman's biweight kernel: 3 / (pi r^2) * (1 - d^2 / r^2)^2
+            const float x = 1.0f - dist_sq / radius_sq[i];
+            fn(photons[i], t, 3.0f * INV_PI * x * x / radius_sq[i]);
+            return false; // Never shrink t_max: every overlapped sphere is visited
+        });
+    }
+
+private:
+    NumaVector<Photon> photons;  // Interleaved over the NUMA nodes, like PhotonMap
+    NumaVector<float> radius_sq;
+    FlatBVH bvh;
+};
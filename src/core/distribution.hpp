@@ -2,29 +2,90 @@
 #include <vector>
 #include <algorithm>
 #include <numeric>
+#include <memory>
 #include "utils.hpp"
 
 /**
- * @brief Handles 1D Probability Distribution Function (PDF) and Cumulative Distribution Function (CDF).
+ * @brief One bin of a Walker / Vose alias table.
+ * With probability 'q' the bin itself is chosen, otherwise its 'alias'.
+ */
+struct AliasBin {
+    float q = 1.0f;
+    int alias = 0;
+};
+
+/**
+ * @brief Builds a Vose alias table for the (unnormalized) weights f[0..n) into out[0..n).
+ * Zero weights are never selected. A zero total yields a uniform table.
+ *
+ * @return double The sum of all weights.
+ */
+inline double build_alias_table(const float* f, int n, AliasBin* out) {
+    double total = 0.0;
+    for (int i = 0; i < n; ++i) total += f[i];
+
+    if (total <= 0.0) {
+        for (int i = 0; i < n; ++i) out[i] = {1.0f, i};
+        return 0.0;
+    }
+
+    // Scale weights so that the average bin holds exactly 1
+    std::vector<double> p(n);
+    std::vector<int> small, large;
+    small.reserve(n);
+    large.reserve(n);
+    for (int i = 0; i < n; ++i) {
+        p[i] = f[i] * n / total;
+        (p[i] < 1.0 ? small : large).push_back(i);
+    }
+
+    // Fill each under-full bin with the excess of an over-full one
+    while (!small.empty() && !large.empty()) {
+        int s = small.back(); small.pop_back();
+        int l = large.back(); large.pop_back();
+        out[s] = {static_cast<float>(p[s]), l};
+        p[l] = (p[l] + p[s]) - 1.0;
+        (p[l] < 1.0 ? small : large).push_back(l);
+    }
+
+    // Leftovers are (up to round-off) exactly full
+    for (int i : large) out[i] = {1.0f, i};
+    for (int i : small) out[i] = {1.0f, i};
+    return total;
+}
+
+/**
+ * @brief O(1) draw from an alias table.
+ * @param u Random number [0, 1).
+ * @param remapped_u [out] A fresh uniform number in [0, 1) recovered from the unused bits of 'u'.
+ * @return int The sampled index.
+ */
+inline int sample_alias_table(const AliasBin* table, int n, float u, float& remapped_u) {
+    float scaled = std::clamp(u, 0.0f, 1.0f) * n;
+    int bin = std::min(static_cast<int>(scaled), n - 1);
+    float up = std::min(scaled - bin, 1.0f);
+
+    const AliasBin& b = table[bin];
+    if (up < b.q) {
+        remapped_u = (b.q > 0.0f) ? up / b.q : 0.0f;
+        return bin;
+    }
+    remapped_u = std::min((up - b.q) / (1.0f - b.q), 1.0f - EPSILON);
+    return b.alias;
+}
+
+/**
+ * @brief Handles 1D Probability Distribution Function (PDF) over a piecewise constant function.
  * Used for importance sampling arrays of data (e.g., texture rows, light lists).
+ * Sampling uses an alias table, so each draw is O(1) instead of a binary search over a CDF.
  */
 struct Distribution1D {
-    std::vector<float> func; // The function values (e.g., luminance)
-    std::vector<float> cdf;  // The cumulative distribution
-    float func_int;          // The integral of the function
-
-    Distribution1D(const float* f, int n) : func(f, f + n), cdf(n + 1) {
-        cdf[0] = 0;
-        for (int i = 0; i < n; ++i) {
-            cdf[i + 1] = cdf[i] + func[i];
-        }
-        float total_sum = cdf[n];
-        func_int = total_sum / float(n);
-        if (func_int == 0) {
-            for (int i = 1; i < n + 1; ++i) cdf[i] = float(i) / float(n);
-        } else {
-            for (int i = 1; i < n + 1; ++i) cdf[i] /= total_sum;
-        }
+    std::vector<float> func;     // The function values (e.g., luminance)
+    std::vector<AliasBin> table; // Alias table over 'func'
+    float func_int;              // The integral of the function
+
+    Distribution1D(const float* f, int n) : func(f, f + n), table(n) {
+        func_int = static_cast<float>(build_alias_table(f, n, table.data()) / n);
     }
 
     Distribution1D(const float* f, size_t n) : Distribution1D(f, static_cast<int>(n)) {}
@@ -39,35 +100,21 @@ struct Distribution1D {
      * @return float Continuous offset.
      */
     float sample_continuous(float u, float& pdf, int& off) const {
-        // Find surrounding CDF segments using binary search
-        u = std::clamp(u, 0.0f, cdf.back() - 2e-7f);
-        auto ptr = std::upper_bound(cdf.begin(), cdf.end(), u);
-        int offset = std::max(0, int(ptr - cdf.begin() - 1));
-        off = offset;
-        
-        // Compute offset along the segment
-        float du = u - cdf[offset];
-        if ((cdf[offset + 1] - cdf[offset]) > 0) {
-            du /= (cdf[offset + 1] - cdf[offset]);
-        }
-        pdf = func_int > 0 ? func[offset] / func_int : 1.0f;
-        return (offset + du) / count();
+        float du;
+        off = sample_alias_table(table.data(), count(), u, du);
+        pdf = func_int > 0 ? func[off] / func_int : 1.0f;
+        return (off + du) / count();
     }
-    
+
     /**
      * @brief Sample discrete index.
      */
     int sample_discrete(float u, float& pdf, float& remapped_u) const {
-        u = std::clamp(u, 0.0f, cdf.back() - 2e-7f);
-        auto ptr = std::upper_bound(cdf.begin(), cdf.end(), u);
-        int offset = std::max(0, int(ptr - cdf.begin() - 1));
-        pdf = (func_int > 0) ? func[offset] / (func_int * count()) : 1.0f / count();
-        
-        // Remap u to [0,1) for the next sampling dimension
-        remapped_u = (u - cdf[offset]) / (cdf[offset+1] - cdf[offset]);
+        int offset = sample_alias_table(table.data(), count(), u, remapped_u);
+        pdf = pdf_discrete(offset);
         return offset;
     }
-    
+
     // Discrete probability of a specific index
     float pdf_discrete(int index) const {
         if (index < 0 || index >= count()) return 0.0f;
@@ -77,23 +124,35 @@ struct Distribution1D {
 
 /**
  * @brief Handles 2D Distribution (e.g., for Image Textures).
- * Composed of one marginal distribution (y-axis) and N conditional distributions (x-axis).
+ * Composed of one marginal distribution (y-axis) and 'nv' conditional distributions (x-axis).
+ * The conditionals share one contiguous nu * nv alias table instead of one allocation per row.
  */
 class Distribution2D {
 public:
-    std::vector<std::unique_ptr<Distribution1D>> p_conditional_v;
+    int nu, nv;
+    std::vector<float> func;             // Row-major function values, nu * nv
+    std::vector<AliasBin> conditional;   // Row-major conditional alias tables, nu * nv
+    std::vector<float> row_int;          // Integral of each row (the marginal function)
     std::unique_ptr<Distribution1D> p_marginal;
 
-    Distribution2D(const float* data, int nu, int nv) {
-        for (int v = 0; v < nv; ++v) {
-            p_conditional_v.emplace_back(std::make_unique<Distribution1D>(&data[v * nu], nu));
-        }
-        
-        std::vector<float> marginal_func;
+    Distribution2D(const float* data, int nu, int nv)
+        : nu(nu), nv(nv), func(data, data + size_t(nu) * nv), conditional(size_t(nu) * nv), row_int(nv) {
+        // Rows are independent, so build them in parallel
+        #pragma omp parallel for schedule(static)
         for (int v = 0; v < nv; ++v) {
-            marginal_func.push_back(p_conditional_v[v]->func_int);
+            size_t offset = size_t(v) * nu;
+            row_int[v] = static_cast<float>(build_alias_table(&func[offset], nu, &conditional[offset]) / nu);
         }
-        p_marginal = std::make_unique<Distribution1D>(marginal_func.data(), nv);
+        p_marginal = std::make_unique<Distribution1D>(row_int.data(), nv);
+    }
+
+    /**
+     * @brief Restore a distribution from previously built tables (e.g. read back from a disk cache).
+     * Only the small marginal table is rebuilt.
+     */
+    Distribution2D(int nu, int nv, std::vector<float> f, std::vector<AliasBin> cond, std::vector<float> rows)
+        : nu(nu), nv(nv), func(std::move(f)), conditional(std::move(cond)), row_int(std::move(rows)) {
+        p_marginal = std::make_unique<Distribution1D>(row_int.data(), nv);
     }
 
     /**
@@ -102,21 +161,23 @@ public:
      * @param pdf [out] The joint PDF p(u,v).
      */
     glm::vec2 sample_continuous(const glm::vec2& u, float& pdf) const {
-        float pdfs[2];
         int v_idx;
-        float d1 = p_marginal->sample_continuous(u.y, pdfs[1], v_idx);
-        
-        int u_idx;
-        float d0 = p_conditional_v[v_idx]->sample_continuous(u.x, pdfs[0], u_idx);
-        
-        pdf = pdfs[0] * pdfs[1];
+        float pdf_v;
+        float d1 = p_marginal->sample_continuous(u.y, pdf_v, v_idx);
+
+        float du;
+        int u_idx = sample_alias_table(&conditional[size_t(v_idx) * nu], nu, u.x, du);
+        float d0 = (u_idx + du) / nu;
+
+        float pdf_u = row_int[v_idx] > 0 ? func[size_t(v_idx) * nu + u_idx] / row_int[v_idx] : 1.0f;
+        pdf = pdf_u * pdf_v;
         return glm::vec2(d0, d1);
     }
 
     float pdf(const glm::vec2& p) const {
-        int iu = std::clamp(int(p.x * p_conditional_v[0]->count()), 0, p_conditional_v[0]->count() - 1);
-        int iv = std::clamp(int(p.y * p_marginal->count()), 0, p_marginal->count() - 1);
-        
-        return p_conditional_v[iv]->func[iu] / p_marginal->func_int;
+        int iu = std::clamp(int(p.x * nu), 0, nu - 1);
+        int iv = std::clamp(int(p.y * nv), 0, nv - 1);
+
+        return func[size_t(iv) * nu + iu] / p_marginal->func_int;
     }
-};
\ No newline at end of file
+};
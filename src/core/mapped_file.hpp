@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MAPPED_FILE_MMAP 1
+#endif
+
+/**
+ * @brief Read-only view of a whole file.
+ * Uses mmap where available, so opening is O(1) and pages are only touched when read;
+ * elsewhere the file is read into a private buffer with identical semantics.
+ */
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& filename) { open(filename); }
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& filename) {
+        close();
+#ifdef MAPPED_FILE_MMAP
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* p = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                mapped = static_cast<const unsigned char*>(p);
+                length = size_t(st.st_size);
+            }
+        }
+        ::close(fd);
+        return mapped != nullptr;
+#else
+        std::ifstream in(filename, std::ios::binary | std::ios::ate);
+        if (!in) return false;
+        buffer.resize(size_t(in.tellg()));
+        in.seekg(0);
+        if (!in.read(reinterpret_cast<char*>(buffer.data()), buffer.size())) { buffer.clear(); return false; }
+        length = buffer.size();
+        return length > 0;
+#endif
+    }
+
+    void close() {
+#ifdef MAPPED_FILE_MMAP
+        if (mapped) munmap(const_cast<unsigned char*>(mapped), length);
+        mapped = nullptr;
+#else
+        buffer.clear();
+#endif
+        length = 0;
+    }
+
+    bool is_open() const { return length > 0; }
+    size_t size() const { return length; }
+
+    const unsigned char* data() const {
+#ifdef MAPPED_FILE_MMAP
+        return mapped;
+#else
+        return buffer.data();
+#endif
+    }
+
+private:
+#ifdef MAPPED_FILE_MMAP
+    const unsigned char* mapped = nullptr;
+#else
+    std::vector<unsigned char> buffer;
+#endif
+    size_t length = 0;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "ray.hpp"
+#include "record.hpp"
+#include <glm/glm.hpp>
+
+class Material;
+
+/**
+ * @brief Participating medium filling the space between surfaces.
+ *
+ * A medium is attached to a closed boundary surface through a MediumInterface. Such a boundary has
+ * no material (HitRecord::mat_ptr is null): the integrator crosses it, switches Ray::medium, and
+ * samples free flights in the current medium against the next surface hit only. Surfaces with a
+ * material never change the medium.
+ */
+class Medium {
+public:
+    virtual ~Medium() = default;
+
+    /**
+     * @brief Sample a free-flight distance along 'r' within [0, t_max].
+     * Sampling is analog: 'weight' does not depend on where the flight is cut, so the integrator may
+     * sample with t_max = Infinity first and bound the surface query by the sampled distance.
+     *
+     * @param rec [out] Scattering event (point, phase function, owner object) if the ray scatters.
+     * @param weight [out] Throughput factor of the sampled event, or of passing through to t_max.
+     * @return true if the ray scatters inside the medium before t_max.
+     */
+    virtual bool sample(const Ray& r, float t_max, HitRecord& rec, glm::vec3& weight) const = 0;
+
+    /**
+     * @brief Fraction of light transmitted along 'r' over [0, t_max].
+     */
+    virtual glm::vec3 transmittance(const Ray& r, float t_max) const = 0;
+
+    /**
+     * @brief Phase function (material) attached to the scattering events returned by sample().
+     */
+    virtual Material* get_phase_function() const = 0;
+};
+
+/**
+ * @brief Media on both sides of a boundary; 'inside' is the side opposite to the outward normal.
+ */
+struct MediumInterface {
+    const Medium* inside = nullptr;
+    const Medium* outside = nullptr;
+};
+
+/**
+ * @brief Medium entered by a ray crossing boundary 'mi' at 'rec' along 'dir'.
+ */
+inline const Medium* medium_after(const MediumInterface& mi, const HitRecord& rec, const glm::vec3& dir) {
+    glm::vec3 outward = rec.front_face ? rec.normal : -rec.normal;
+    return glm::dot(dir, outward) < 0.0f ? mi.inside : mi.outside;
+}
@@ -0,0 +1,273 @@
+#pragma once
+
+#include "utils.hpp"
+#include <omp.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define NUMA_LINUX 1
+#endif
+
+/**
+ * @brief NUMA nodes and the CPUs of each, as far as this process may use them.
+ *
+ * Read once from /sys/devices/system/node (no libnuma needed) and intersected with the process
+ * affinity mask. Elsewhere, or on single-node machines, everything degrades to one node and the
+ * placement / pinning calls become no-ops.
+ */
+class NumaTopology {
+public:
+    static const NumaTopology& instance() {
+        static NumaTopology topology;
+        return topology;
+    }
+
+    int node_count() const { return static_cast<int>(node_ids.size()); }
+
+    /**
+     * @brief Node serving OpenMP thread 'thread' out of 'threads' once pin_openmp_threads() ran.
+     * Threads are spread over the CPUs in node order, so consecutive threads share a node.
+     */
+    int node_of_thread(int thread, int threads) const {
+        if (cpus.empty()) return 0;
+        return cpu_nodes[slot_of_thread(thread, threads)];
+    }
+
+    /**
+     * @brief Pin every OpenMP thread to its own CPU, grouped by node.
+     * Skipped when the user already binds threads (OMP_PROC_BIND / OMP_PLACES) or on one node.
+     */
+    void pin_openmp_threads() const {
+        if (!pinning_enabled()) return;
+        int pinned = 0;
+        #pragma omp parallel reduction(+:pinned)
+        {
+            int threads = omp_get_num_threads();
+            pinned += pin_current_thread(cpus[slot_of_thread(omp_get_thread_num(), threads)]) ? 1 : 0;
+        }
+        std::cout << "[NUMA] " << node_count() << " nodes, pinned " << pinned << " threads." << std::endl;
+    }
+
+    bool pinning_enabled() const {
+        return node_count() > 1 && !std::getenv("OMP_PROC_BIND") && !std::getenv("OMP_PLACES");
+    }
+
+    /**
+     * @brief Memory policy for a fresh (untouched) range: pages interleaved over all nodes, or split
+     * into node_count() equal consecutive blocks, block n preferring node n. Also requests
+     * transparent huge pages. Both are hints: failures are ignored.
+     */
+    void interleave(void* p, size_t bytes) const { place(p, bytes, true); }
+    void block(void* p, size_t bytes) const { place(p, bytes, false); }
+
+private:
+    std::vector<int> node_ids;   // Kernel node numbers (may be sparse)
+    std::vector<int> cpus;       // Usable CPUs, in node order
+    std::vector<int> cpu_nodes;  // Index into node_ids of each entry of 'cpus'
+
+    NumaTopology() {
+#ifdef NUMA_LINUX
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return;
+
+        for (int node = 0; node < NUMA_MAX_NODES; ++node) {
+            std::ifstream in("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            if (!in) continue;
+            std::string list;
+            std::getline(in, list);
+
+            std::vector<int> node_cpus;
+            for (int cpu : parse_cpu_list(list))
+                if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) node_cpus.push_back(cpu);
+            if (node_cpus.empty()) continue;
+
+            for (int cpu : node_cpus) {
+                cpus.push_back(cpu);
+                cpu_nodes.push_back(static_cast<int>(node_ids.size()));
+            }
+            node_ids.push_back(node);
+        }
+#endif
+        if (node_ids.empty()) node_ids.push_back(0);
+    }
+
+    /**
+     * @brief "0-3,8,10-11" -> {0, 1, 2, 3, 8, 10, 11}.
+     */
+    static std::vector<int> parse_cpu_list(const std::string& list) {
+        std::vector<int> result;
+        std::stringstream ss(list);
+        std::string range;
+        while (std::getline(ss, range, ',')) {
+            if (range.empty()) continue;
+            size_t dash = range.find('-');
+            int first = std::atoi(range.c_str());
+            int last = dash == std::string::npos ? first : std::atoi(range.c_str() + dash + 1);
+            for (int cpu = first; cpu <= last; ++cpu) result.push_back(cpu);
+        }
+        return result;
+    }
+
+    size_t slot_of_thread(int thread, int threads) const {
+        if (threads <= 0 || cpus.empty()) return 0;
+        if (size_t(threads) >= cpus.size()) return size_t(thread) % cpus.size();
+        return size_t(thread) * cpus.size() / size_t(threads); // Spread evenly, so every node gets its share
+    }
+
+    static bool pin_current_thread(int cpu) {
+#ifdef NUMA_LINUX
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+        return false;
+#endif
+    }
+
+    void place(void* p, size_t bytes, bool interleaved) const {
+#ifdef NUMA_LINUX
+        madvise(p, bytes, MADV_HUGEPAGE);
+        if (node_count() < 2) return;
+
+        constexpr int MPOL_PREFERRED_MODE = 1;
+        constexpr int MPOL_INTERLEAVE_MODE = 3;
+        constexpr unsigned long MASK_BITS = 8 * sizeof(unsigned long) * 16;
+        unsigned long mask[16] = {};
+
+        if (interleaved) {
+            for (int id : node_ids) mask[id / 64] |= 1ul << (id % 64);
+            syscall(SYS_mbind, p, bytes, MPOL_INTERLEAVE_MODE, mask, MASK_BITS, 0u);
+            return;
+        }
+
+        const size_t page = size_t(sysconf(_SC_PAGESIZE));
+        const size_t n = node_ids.size();
+        for (size_t k = 0; k < n; ++k) {
+            size_t begin = (bytes * k / n) / page * page;
+            size_t end = k + 1 == n ? bytes : (bytes * (k + 1) / n) / page * page;
+            if (end <= begin) continue;
+            std::fill(std::begin(mask), std::end(mask), 0ul);
+            mask[node_ids[k] / 64] |= 1ul << (node_ids[k] % 64);
+            syscall(SYS_mbind, static_cast<char*>(p) + begin, end - begin, MPOL_PREFERRED_MODE, mask, MASK_BITS, 0u);
+        }
+#endif
+    }
+};
+
+/**
+ * @brief Where a NumaAllocator puts its pages (see NumaTopology::interleave / block).
+ */
+enum class NumaPlacement : uint8_t { Interleave, Block };
+
+/**
+ * @brief Allocator for large, long-lived arrays (photon maps, BVH nodes, the film).
+ * Blocks of at least NUMA_HUGE_PAGE_SIZE are mapped directly, aligned to huge pages and given their
+ * NUMA policy before the container first touches them; smaller blocks use operator new.
+ */
+template <typename T>
+class NumaAllocator {
+public:
+    using value_type = T;
+
+    NumaAllocator(NumaPlacement p = NumaPlacement::Interleave) noexcept : placement(p) {}
+    template <typename U>
+    NumaAllocator(const NumaAllocator<U>& other) noexcept : placement(other.placement) {}
+
+    T* allocate(size_t n) {
+        const size_t bytes = n * sizeof(T);
+        if (bytes < NUMA_HUGE_PAGE_SIZE) return static_cast<T*>(::operator new(bytes));
+#ifdef NUMA_LINUX
+        const size_t mapped = round_up(bytes);
+        // Over-map by one huge page and trim, so the block starts on a huge page boundary
+        void* raw = mmap(nullptr, mapped + NUMA_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED) throw std::bad_alloc();
+        char* base = static_cast<char*>(raw);
+        char* aligned = base + (NUMA_HUGE_PAGE_SIZE - reinterpret_cast<uintptr_t>(base) % NUMA_HUGE_PAGE_SIZE) % NUMA_HUGE_PAGE_SIZE;
+        if (aligned > base) munmap(base, aligned - base);
+        char* tail = aligned + mapped;
+        if (base + mapped + NUMA_HUGE_PAGE_SIZE > tail) munmap(tail, base + mapped + NUMA_HUGE_PAGE_SIZE - tail);
+
+        if (placement == NumaPlacement::Interleave) NumaTopology::instance().interleave(aligned, mapped);
+        else NumaTopology::instance().block(aligned, mapped);
+        return reinterpret_cast<T*>(aligned);
+#else
+        return static_cast<T*>(::operator new(bytes));
+#endif
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+        const size_t bytes = n * sizeof(T);
+#ifdef NUMA_LINUX
+        if (bytes >= NUMA_HUGE_PAGE_SIZE) { munmap(p, round_up(bytes)); return; }
+#endif
+        ::operator delete(p);
+    }
+
+    template <typename U>
+    bool operator==(const NumaAllocator<U>& other) const noexcept { return placement == other.placement; }
+    template <typename U>
+    bool operator!=(const NumaAllocator<U>& other) const noexcept { return placement != other.placement; }
+
+    NumaPlacement placement;
+
+private:
+    static size_t round_up(size_t bytes) {
+        return (bytes + NUMA_HUGE_PAGE_SIZE - 1) / NUMA_HUGE_PAGE_SIZE * NUMA_HUGE_PAGE_SIZE;
+    }
+};
+
+template <typename T>
+using NumaVector = std::vector<T, NumaAllocator<T>>;
+
+/**
+ * @brief Hands out image rows so each thread works on its own node's band of the film first.
+ * Rows are split into node_count() consecutive bands (matching NumaPlacement::Block on a
+ * row-major film); a thread that finished its band steals from the other nodes' bands.
+ */
+class NumaRowScheduler {
+public:
+    explicit NumaRowScheduler(int rows) : bands(NumaTopology::instance().node_count()), next_row(new Counter[bands]) {
+        for (int k = 0; k < bands; ++k) {
+            next_row[k].value = rows * k / bands;
+            band_end.push_back(rows * (k + 1) / bands);
+        }
+    }
+
+    /**
+     * @brief Next row for OpenMP thread 'thread' of 'threads', false when all rows are taken.
+     */
+    bool next(int thread, int threads, int& row) {
+        const int home = NumaTopology::instance().pinning_enabled()
+                       ? NumaTopology::instance().node_of_thread(thread, threads) : 0;
+        for (int k = 0; k < bands; ++k) {
+            const int band = (home + k) % bands;
+            if (next_row[band].value.load(std::memory_order_relaxed) >= band_end[band]) continue;
+            row = next_row[band].value.fetch_add(1, std::memory_order_relaxed);
+            if (row < band_end[band]) return true;
+        }
+        return false;
+    }
+
+private:
+    struct alignas(64) Counter { std::atomic<int> value{0}; }; // One cache line each
+
+    int bands;
+    std::unique_ptr<Counter[]> next_row;
+    std::vector<int> band_end;
+};
@@ -1,6 +1,8 @@
 #pragma once
 #include <glm/glm.hpp>
 
+class Medium;
+
 /**
  * @brief Represents a ray in 3D space defined by an origin and a direction.
  * Equation: P(t) = origin + t * direction
@@ -49,4 +51,12 @@ public:
     glm::vec3 inv_dir; // Cached inverse direction
     float tm;
     float wavelength; // in nm, 0.0f means full spectrum (white)
+
+    // Ray cone for texture filtering: footprint width at the origin and its spread angle (radians).
+    // Zero for rays that do not originate from the camera (no filtering).
+    float cone_width = 0.0f;
+    float cone_spread = 0.0f;
+
+    // Participating medium the ray travels through (nullptr = vacuum), kept up to date by the integrator.
+    const Medium* medium = nullptr;
 };
\ No newline at end of file
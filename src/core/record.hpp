@@ -2,6 +2,7 @@
 
 #include <glm/glm.hpp>
 #include "ray.hpp"
+#include "onb.hpp"
 class Object; 
 class Material;
 
@@ -18,6 +19,9 @@ struct HitRecord {
     float u;                      ///< Texture coordinate U [0,1].
     float v;                      ///< Texture coordinate V [0,1].
     const Object* object = nullptr; ///< Pointer to the geometric object hit. (Added for MIS)
+    int prim_id = -1;             ///< Primitive index inside 'object' (triangle of a mesh), -1 if not applicable.
+    float uv_scale = 0.0f;        ///< UV units per world unit around the hit (0 if the UVs are not meant for filtering).
+    float uv_width = 0.0f;        ///< Ray footprint in UV units, filled by the integrator for MIP level selection.
 
     /**
      * @brief Sets the hit record normal and front_face flag based on ray direction.
@@ -32,6 +36,137 @@ struct HitRecord {
     }
 };
 
+/**
+ * @brief BSDF closure of one shading point, resolved once by Material::scatter.
+ * Holds the looked-up albedo and the shading frame, so light sampling (NEE), MIS and the
+ * throughput update evaluate the lobe without fetching textures or building an Onb again.
+ * Small and trivially copyable: it lives on the stack inside ScatterRecord.
+ */
+struct BsdfClosure {
+    enum class Lobe { None, Diffuse, Glossy, Isotropic };
+
+    Lobe lobe = Lobe::None;  // None: specular / absorbing, eval and pdf are zero
+    glm::vec3 albedo = glm::vec3(0.0f); // Glossy: reflectance at normal incidence (F0)
+    Onb frame;               // Shading frame, w() is the shading normal
+    glm::vec3 wo = glm::vec3(0.0f, 0.0f, 1.0f); // Glossy: direction to the viewer, in the shading frame
+    float alpha = 0.0f;      // Glossy: GGX roughness
+
+    /**
+     * @brief BSDF value f(wi) (without the cosine term).
+     * @tparam Volumes false when the scene has no participating media: the Isotropic case is compiled out.
+     */
+    template <bool Volumes = true>
+    glm::vec3 eval(const glm::vec3& wi) const {
+        if (Volumes && lobe == Lobe::Isotropic) return albedo * INV_4PI;
+        switch (lobe) {
+        case Lobe::Diffuse: return glm::dot(frame.w(), wi) > 0.0f ? albedo * INV_PI : glm::vec3(0.0f);
+        case Lobe::Glossy:  return eval_ggx(frame.world_to_local(glm::normalize(wi)));
+        default:            return glm::vec3(0.0f);
+        }
+    }
+
+    /**
+     * @brief Solid angle PDF of sample() producing direction 'wi'.
+     */
+    template <bool Volumes = true>
+    float pdf(const glm::vec3& wi) const {
+        if (Volumes && lobe == Lobe::Isotropic) return INV_4PI;
+        switch (lobe) {
+        case Lobe::Diffuse: {
+            float cosine = glm::dot(frame.w(), glm::normalize(wi));
+            return cosine < 0.0f ? 0.0f : cosine * INV_PI;
+        }
+        case Lobe::Glossy:  return pdf_ggx(frame.world_to_local(glm::normalize(wi)));
+        default:            return 0.0f;
+        }
+    }
+
+    /**
+     * @brief Draw a normalized direction from the lobe.
+     * @param pdf [out] Solid angle PDF of the direction.
+     */
+    glm::vec3 sample(float& pdf) const {
+        switch (lobe) {
+        case Lobe::Diffuse: {
+            // Cosine weighted in the shading frame: p(direction) = cos(theta) / PI
+            glm::vec3 direction = glm::normalize(frame.local(random_cosine_direction()));
+            pdf = glm::dot(frame.w(), direction) * INV_PI;
+            return direction;
+        }
+        case Lobe::Glossy: {
+            // Reflect the viewer about a visible normal; directions below the surface get pdf 0
+            glm::vec3 m = sample_ggx_visible_normal(random_float(), random_float());
+            glm::vec3 wi = 2.0f * glm::dot(wo, m) * m - wo;
+            pdf = pdf_ggx(wi);
+            return glm::normalize(frame.local(wi));
+        }
+        case Lobe::Isotropic:
+            pdf = INV_4PI;
+            return random_unit_vector();
+        default:
+            pdf = 0.0f;
+            return frame.w();
+        }
+    }
+
+private:
+    // GGX (Trowbridge-Reitz) microfacet terms, all vectors in the shading frame (normal = +z).
+
+    float ggx_d(const glm::vec3& m) const {
+        float a2 = alpha * alpha;
+        float t = (m.x * m.x + m.y * m.y) / a2 + m.z * m.z;
+        return 1.0f / (PI * a2 * t * t);
+    }
+
+    // Smith Lambda, G1(v) = 1 / (1 + Lambda(v))
+    float ggx_lambda(const glm::vec3& v) const {
+        float tan2 = (v.x * v.x + v.y * v.y) / (v.z * v.z);
+        return 0.5f * (std::sqrt(1.0f + alpha * alpha * tan2) - 1.0f);
+    }
+
+    glm::vec3 eval_ggx(const glm::vec3& wi) const {
+        if (wi.z <= 0.0f || wo.z <= 0.0f) return glm::vec3(0.0f);
+        glm::vec3 m = glm::normalize(wi + wo);
+        // Schlick Fresnel with the albedo as F0 (conductor tint)
+        float c = 1.0f - std::max(glm::dot(wi, m), 0.0f);
+        float c2 = c * c;
+        glm::vec3 fresnel = albedo + (glm::vec3(1.0f) - albedo) * (c2 * c2 * c);
+        float g2 = 1.0f / (1.0f + ggx_lambda(wo) + ggx_lambda(wi));
+        return fresnel * (ggx_d(m) * g2 / (4.0f * wo.z * wi.z));
+    }
+
+    // Visible normal distribution: p(wi) = G1(wo) D(m) / (4 wo.z)
+    float pdf_ggx(const glm::vec3& wi) const {
+        if (wi.z <= 0.0f || wo.z <= 0.0f) return 0.0f;
+        glm::vec3 m = glm::normalize(wi + wo);
+        return ggx_d(m) / ((1.0f + ggx_lambda(wo)) * 4.0f * wo.z);
+    }
+
+    /**
+     * @brief Microfacet normal from the distribution of normals visible from 'wo'
+     * (Heitz 2018, "Sampling the GGX Distribution of Visible Normals").
+     */
+    glm::vec3 sample_ggx_visible_normal(float u1, float u2) const {
+        // Stretch the view direction to the hemisphere configuration
+        glm::vec3 vh = glm::normalize(glm::vec3(alpha * wo.x, alpha * wo.y, wo.z));
+        float len2 = vh.x * vh.x + vh.y * vh.y;
+        glm::vec3 t1 = len2 > 0.0f ? glm::vec3(-vh.y, vh.x, 0.0f) / std::sqrt(len2) : glm::vec3(1.0f, 0.0f, 0.0f);
+        glm::vec3 t2 = glm::cross(vh, t1);
+
+        // Uniform point on the projected disk, squashed towards the visible half
+        float r = std::sqrt(u1);
+        float phi = 2.0f * PI * u2;
+        float p1 = r * std::cos(phi);
+        float p2 = r * std::sin(phi);
+        float s = 0.5f * (1.0f + vh.z);
+        p2 = (1.0f - s) * std::sqrt(std::max(0.0f, 1.0f - p1 * p1)) + s * p2;
+
+        // Back to the ellipsoid configuration
+        glm::vec3 nh = p1 * t1 + p2 * t2 + std::sqrt(std::max(0.0f, 1.0f - p1 * p1 - p2 * p2)) * vh;
+        return glm::normalize(glm::vec3(alpha * nh.x, alpha * nh.y, std::max(0.0f, nh.z)));
+    }
+};
+
 /**
  * @brief Class to record detailed information of a scatter.
  */
@@ -41,5 +176,6 @@ struct ScatterRecord {
     glm::vec3 attenuation;  // Albedo.
     float pdf;              // If the surface is not mirror, then the PDF of the sampled direction is recorded.
     glm::vec3 shading_normal;  // Perturbed normal from normal map (if any).
+    BsdfClosure bsdf;          // Resolved lobe for eval / pdf of non-specular events.
     ScatterRecord(glm::vec3 normal) : shading_normal(normal) {} // A normal initialization is a must. We should always have a valid normal.
 };
\ No newline at end of file
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief One node of the TaskGraph. Only the graph touches its fields (under the graph lock).
+ */
+struct TaskNode {
+    std::function<void()> fn;
+    std::vector<std::shared_ptr<TaskNode>> successors; // Released when this task finishes
+    int pending = 0;                                   // Unfinished dependencies
+    bool done = false;
+};
+
+using TaskHandle = std::shared_ptr<TaskNode>;
+
+/**
+ * @brief Process-wide task graph on a persistent thread pool, for the startup phases.
+ *
+ * Tasks run as soon as all of their dependencies have finished, so independent work (mesh loads,
+ * texture decodes, the environment map distribution) overlaps, and dependent work starts the moment
+ * its inputs are ready instead of after a global barrier. Threads are started on first use and idle
+ * on a condition variable afterwards, so they cost nothing while OpenMP renders.
+ *
+ * Waiting is cooperative: a thread blocked in wait() runs ready tasks meanwhile, which also makes it
+ * safe to wait from inside a task.
+ */
+class TaskGraph {
+public:
+    static TaskGraph& instance() {
+        static TaskGraph graph;
+        return graph;
+    }
+
+    ~TaskGraph() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        work_available.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+
+    /**
+     * @brief Schedule 'fn' to run after every task in 'deps' has finished (null handles are ignored).
+     */
+    TaskHandle submit(std::function<void()> fn, const std::vector<TaskHandle>& deps = {}) {
+        auto node = std::make_shared<TaskNode>();
+        node->fn = std::move(fn);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        if (workers.empty()) start_workers();
+        ++outstanding;
+        for (const auto& dep : deps) {
+            if (!dep || dep->done) continue;
+            dep->successors.push_back(node);
+            ++node->pending;
+        }
+        if (node->pending == 0) {
+            ready.push_back(node);
+            lock.unlock();
+            work_available.notify_one();
+        }
+        return node;
+    }
+
+    /**
+     * @brief Block until 'task' has finished, running other ready tasks in the meantime.
+     */
+    void wait(const TaskHandle& task) {
+        if (!task) return;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!task->done) {
+            if (!ready.empty()) run_one(lock);
+            else task_finished.wait(lock);
+        }
+    }
+
+    /**
+     * @brief Block until every submitted task has finished.
+     */
+    void wait_all() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (outstanding > 0) {
+            if (!ready.empty()) run_one(lock);
+            else task_finished.wait(lock);
+        }
+    }
+
+    unsigned thread_count() const { return std::max(1u, std::thread::hardware_concurrency()); }
+
+private:
+    std::mutex mutex;
+    std::condition_variable work_available;
+    std::condition_variable task_finished;
+    std::deque<TaskHandle> ready;
+    std::vector<std::thread> workers;
+    size_t outstanding = 0;
+    bool stopping = false;
+
+    TaskGraph() = default;
+
+    void start_workers() {
+        for (unsigned i = 0; i < thread_count(); ++i)
+            workers.emplace_back([this] { worker_loop(); });
+    }
+
+    void worker_loop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            work_available.wait(lock, [this] { return stopping || !ready.empty(); });
+            if (ready.empty()) return; // Stopping and drained
+            run_one(lock);
+        }
+    }
+
+    /**
+     * @brief Pop and run the front ready task outside the lock, then release its successors.
+     */
+    void run_one(std::unique_lock<std::mutex>& lock) {
+        TaskHandle task = std::move(ready.front());
+        ready.pop_front();
+        lock.unlock();
+        task->fn();
+        task->fn = nullptr; // Drop captured state early
+        lock.lock();
+
+        task->done = true;
+        --outstanding;
+        size_t released = 0;
+        for (auto& next : task->successors) {
+            if (--next->pending == 0) {
+                ready.push_back(std::move(next));
+                ++released;
+            }
+        }
+        task->successors.clear();
+        if (released == 1) work_available.notify_one();
+        else if (released > 1) work_available.notify_all();
+        task_finished.notify_all();
+    }
+};
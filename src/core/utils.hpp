@@ -5,6 +5,9 @@
 #include <memory>
 #include <random>
 #include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <string>
 
 // Common Headers
 #include <glm/glm.hpp>
@@ -16,6 +19,7 @@
 const float Infinity = std::numeric_limits<float>::infinity();
 const float PI = glm::pi<float>();
 const float INV_PI = 1.0f / PI;
+const float INV_4PI = 1.0f / (4.0f * PI); // Uniform sphere PDF
 
 // Math tolerance for checking zero, etc. (1e-6 is safer for float than 1e-8)
 const float EPSILON = 1e-6f;
@@ -26,6 +30,58 @@ const float SHADOW_EPSILON = 1e-3f;
 // Padding for bounding box
 const float PADDING_EPSILON = 1e-3f;
 
+// Solid angle range (steradians) in which spherical triangle sampling is numerically reliable.
+// Outside of it (tiny distant triangles or nearly hemispherical ones) we fall back to area sampling.
+const float MIN_SPHERICAL_SAMPLE_AREA = 3e-4f;
+const float MAX_SPHERICAL_SAMPLE_AREA = 6.22f;
+
+// Side length limits of the equal-area octahedral environment map (radiance texels),
+// and of the importance sampling distribution built over it.
+const int ENV_MAP_MAX_RESOLUTION = 4096;
+const int ENV_MAP_MIN_RESOLUTION = 16;
+const int ENV_DISTRIBUTION_RESOLUTION = 512;
+
+// Ray cones: extra spread angle (radians) added by a non-specular bounce,
+// and the minimum |cos| used when projecting the cone onto grazing surfaces.
+const float RAY_CONE_DIFFUSE_SPREAD = 0.1f;
+const float RAY_CONE_MIN_COSINE = 0.05f;
+
+// Media: boundary crossings followed along one ray segment before it is considered lost.
+const int MEDIUM_MAX_CROSSINGS = 64;
+
+// Grid media: voxels per side of a sparse brick (one majorant super-grid cell), and the ratio tracking
+// transmittance below which Russian roulette starts.
+const int GRID_MEDIUM_BRICK_SIZE = 8;
+const float GRID_MEDIUM_RR_THRESHOLD = 0.1f;
+
+// Metal: GGX roughness (alpha) below which the surface is treated as a perfect (delta) mirror.
+const float METAL_SPECULAR_ALPHA = 1e-3f;
+
+// Texture cache: side length of a square tile (texels), number of lock shards, default memory cap.
+const int TEXTURE_TILE_SIZE = 64;
+const int TEXTURE_CACHE_SHARDS = 16;
+const int TEXTURE_CACHE_DEFAULT_MB = 512;
+
+// NUMA: highest node number probed, and the (transparent) huge page size; NumaAllocator maps
+// blocks of at least one huge page directly so they get a NUMA policy and huge pages.
+const int NUMA_MAX_NODES = 64;
+const size_t NUMA_HUGE_PAGE_SIZE = size_t(2) << 20;
+
+// Flat BVH: maximum number of primitives per leaf.
+const int FLAT_BVH_LEAF_SIZE = 4;
+const int FLAT_BVH_SAH_BINS = 16;       // Centroid bins evaluated per split by the SAH builder
+const int FLAT_BVH_STACK_SIZE = 64;     // Traversal stack entries (bounds the tree depth)
+const int FLAT_BVH_SAH_MAX_DEPTH = 32;  // Deeper nodes split at the median, so depth stays below the stack size
+
+// Time-budgeted rendering: share of the predicted capacity spent by the last batch, and the time
+// kept free for the final outputs, in multiples of the measured snapshot time.
+const float TIME_BUDGET_SAFETY = 0.9f;
+const float TIME_BUDGET_RESERVE = 3.0f;
+
+// FNV-1a (64-bit) parameters, used to key on-disk caches by content.
+const uint64_t FNV1A_64_OFFSET = 14695981039346656037ull;
+const uint64_t FNV1A_64_PRIME = 1099511628211ull;
+
 /**
  * @brief Generates a random float in range [0.0, 1.0).
  * 
@@ -182,6 +238,110 @@ inline glm::vec3 uv_to_sphere(float u, float v) {
     return glm::vec3(-sin_theta * cos_phi, -cos_theta, sin_theta * sin_phi);
 }
 
+/**
+ * @brief Equal-area octahedral mapping from the unit square to the unit sphere (Clarberg 2008).
+ * Every region of the square maps to a region of the sphere with proportional solid angle,
+ * so a uniform density over [0,1]^2 is a uniform density of 1/(4*PI) over directions.
+ * 
+ * @param p Point in [0, 1]^2.
+ * @return glm::vec3 Normalized direction.
+ */
+inline glm::vec3 equal_area_square_to_sphere(const glm::vec2& p) {
+    float u = 2.0f * p.x - 1.0f;
+    float v = 2.0f * p.y - 1.0f;
+    float up = std::abs(u);
+    float vp = std::abs(v);
+
+    // Signed distance from the diagonal: positive on the upper (+Z) hemisphere
+    float signed_distance = 1.0f - (up + vp);
+    float d = std::abs(signed_distance);
+    float r = 1.0f - d;
+
+    float phi = (r == 0.0f ? 1.0f : (vp - up) / r + 1.0f) * PI / 4.0f;
+    float z = std::copysign(1.0f - r * r, signed_distance);
+
+    float cos_phi = std::copysign(std::cos(phi), u);
+    float sin_phi = std::copysign(std::sin(phi), v);
+    float scale = r * std::sqrt(std::max(0.0f, 2.0f - r * r));
+    return glm::vec3(cos_phi * scale, sin_phi * scale, z);
+}
+
+/**
+ * @brief Inverse of equal_area_square_to_sphere.
+ * 
+ * @param d Normalized direction.
+ * @return glm::vec2 Point in [0, 1]^2.
+ */
+inline glm::vec2 equal_area_sphere_to_square(const glm::vec3& d) {
+    float x = std::abs(d.x);
+    float y = std::abs(d.y);
+    float z = std::abs(d.z);
+
+    float r = std::sqrt(std::max(0.0f, 1.0f - z));
+    float a = std::max(x, y);
+    float b = std::min(x, y);
+    b = (a == 0.0f) ? 0.0f : b / a;
+
+    float phi = std::atan(b) * 2.0f / PI;
+    if (x < y) phi = 1.0f - phi;
+
+    float v = phi * r;
+    float u = r - v;
+    if (d.z < 0.0f) {
+        std::swap(u, v);
+        u = 1.0f - u;
+        v = 1.0f - v;
+    }
+
+    u = std::copysign(u, d.x);
+    v = std::copysign(v, d.y);
+    return glm::vec2(0.5f * (u + 1.0f), 0.5f * (v + 1.0f));
+}
+
+/**
+ * @brief Numerically robust angle between two normalized vectors.
+ * Avoids acos() precision loss when the vectors are nearly parallel or anti-parallel.
+ */
+inline float angle_between(const glm::vec3& a, const glm::vec3& b) {
+    if (glm::dot(a, b) < 0.0f)
+        return PI - 2.0f * std::asin(std::clamp(glm::length(a + b) * 0.5f, -1.0f, 1.0f));
+    return 2.0f * std::asin(std::clamp(glm::length(b - a) * 0.5f, -1.0f, 1.0f));
+}
+
+/**
+ * @brief Component of v orthogonal to the normalized vector w (one Gram-Schmidt step).
+ */
+inline glm::vec3 gram_schmidt(const glm::vec3& v, const glm::vec3& w) {
+    return v - glm::dot(v, w) * w;
+}
+
+/**
+ * @brief Size and modification time of a file, used to validate caches derived from it.
+ * @return false If the file does not exist or cannot be queried.
+ */
+inline bool file_stamp(const std::string& filename, uint64_t& size, int64_t& mtime) {
+    std::error_code ec;
+    size = std::filesystem::file_size(filename, ec);
+    if (ec) return false;
+    auto time = std::filesystem::last_write_time(filename, ec);
+    if (ec) return false;
+    mtime = static_cast<int64_t>(time.time_since_epoch().count());
+    return true;
+}
+
+/**
+ * @brief 64-bit FNV-1a hash of a byte range; pass a previous result as 'seed' to chain ranges.
+ */
+inline uint64_t fnv1a_64(const void* data, size_t size, uint64_t seed = FNV1A_64_OFFSET) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= FNV1A_64_PRIME;
+    }
+    return hash;
+}
+
 inline float grayscale(const glm::vec3& color) {
     return 0.2126f * color.r + 0.7152f * color.g + 0.0722f * color.b;
 }
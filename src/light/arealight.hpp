@@ -1,7 +1,7 @@
 #pragma once
 
 #include "../object/object_utils.hpp"
-#include "../material/material_utils.hpp" 
+#include "../material/material_dispatch.hpp"
 #include "../core/onb.hpp"
 #include "light_utils.hpp"
 
@@ -15,7 +15,12 @@ public:
     /**
      * @param obj The geometric object that is emitting light.
      */
-    DiffuseAreaLight(std::shared_ptr<Object> obj) : shape(obj) {
+    DiffuseAreaLight(std::shared_ptr<Object> obj) : shape(obj) { refresh(); }
+
+    /**
+     * @brief Power estimate from a few emission samples over the shape.
+     */
+    virtual void refresh() override {
         glm::vec3 pos, normal; float area;
         shape->sample_surface(pos, normal, area);
 
@@ -23,7 +28,7 @@ public:
         const int samples = 8;
         for(int i=0; i<samples; ++i) {
             shape->sample_surface(pos, normal, area);
-            accum_emit += shape->get_material()->emitted(0, 0, pos);
+            accum_emit += material_emitted(*shape->get_material(), 0, 0, pos);
         }
         glm::vec3 avg_emit = accum_emit / float(samples);
         this -> est_power = grayscale(avg_emit) * area * PI;
@@ -32,7 +37,8 @@ public:
 
     virtual glm::vec3 sample_li(const glm::vec3& origin, glm::vec3& wi, float& pdf, float& distance) const override {
         // 1. Get vector from origin to a random point on the light source
-        glm::vec3 to_light_vector = shape->random_pointing_vector(origin);
+        //    The shape reports the solid angle PDF of the sample directly (no re-intersection).
+        glm::vec3 to_light_vector = shape->random_pointing_vector(origin, pdf);
         
         // 2. Calculate distance
         distance = glm::length(to_light_vector);
@@ -44,16 +50,13 @@ public:
         // 3. Normalize to get direction
         wi = to_light_vector / distance;
 
-        // 4. Get the PDF of this direction (Solid Angle PDF for Sphere)
-        pdf = shape->pdf_value(origin, wi);
-        
         if (pdf <= EPSILON) return glm::vec3(0.0f);
 
-        // 5. Get emitted radiance
+        // 4. Get emitted radiance
         // Note: For Area lights, emission is usually directional (cosine weighted at the source),
         // but DiffuseLight material simplifies this to uniform emission.
         // We supply the actual hit point (origin + wi * distance) to support spatially varying emission textures.
-        return shape->get_material()->emitted(0, 0, origin + wi * distance); 
+        return material_emitted(*shape->get_material(), 0, 0, origin + wi * distance); 
     }    
     
     /**
@@ -63,6 +66,10 @@ public:
         return shape->pdf_value(origin, wi);
     }
 
+    virtual float pdf_value(const glm::vec3& origin, const glm::vec3& wi, const HitRecord& rec) const override {
+        return shape->pdf_value(origin, wi, rec);
+    }
+
     virtual void emit(glm::vec3& p_pos, glm::vec3& p_dir, glm::vec3& p_power, float total_photons) const override {
         glm::vec3 normal;
         float area;
@@ -77,7 +84,7 @@ public:
         Onb uvw(normal);
         p_dir = uvw.local(random_cosine_direction());
 
-        glm::vec3 Le = shape->get_material()->emitted(0, 0, p_pos);
+        glm::vec3 Le = material_emitted(*shape->get_material(), 0, 0, p_pos);
         p_power = (Le * PI * area) / total_photons;
     }
 
@@ -89,7 +96,8 @@ public:
         shape->sample_surface(p_pos, light_normal, area);
         if (area <= EPSILON) return false;
 
-        glm::vec3 vec_to_target = target.random_pointing_vector(p_pos);
+        float pdf_dir;
+        glm::vec3 vec_to_target = target.random_pointing_vector(p_pos, pdf_dir);
         float dist = glm::length(vec_to_target);
         
         if (dist <= EPSILON) return false;
@@ -100,10 +108,9 @@ public:
             p_power = glm::vec3(0.0f);
             return false;
         }
-        float pdf_dir = target.pdf_value(p_pos, p_dir);
         
         if (pdf_dir <= EPSILON) return false;
-        glm::vec3 Le = shape->get_material()->emitted(0.0f, 0.0f, p_pos);
+        glm::vec3 Le = material_emitted(*shape->get_material(), 0.0f, 0.0f, p_pos);
         float total_pdf = pdf_dir / area;
         p_power = (Le * cos_theta) / (total_photons * total_pdf);
 
@@ -4,6 +4,7 @@
 #include "light_utils.hpp"
 #include "../core/distribution.hpp"
 #include "../texture/image_texture.hpp"
+#include "envmap.hpp"
 /**
  * @brief Infinite Area Light (Environment Light).
  * Represents a distant light source surrounding the scene (e.g., HDRI).
@@ -24,6 +25,7 @@ public:
             int h = img_tex->get_height();
             std::vector<float> luminance(w * h);
 
+            #pragma omp parallel for schedule(static)
             for (int v = 0; v < h; ++v) {
                 // Equirectangular mapping distortion correction: sin(theta)
                 float vp = (v + 0.5f) / float(h);
@@ -54,6 +56,13 @@ public:
         // if(this -> est_power < EPSILON) this -> est_power = EPSILON;
     }
 
+    /**
+     * @brief Construct from a dedicated environment map store (octahedral RGBE + cached distribution).
+     */
+    EnvironmentLight(std::shared_ptr<EnvironmentMap> map) : env_map(map) {
+        this->est_power = env_map->power();
+    }
+
     /**
      * @brief Samples a direction from the environment.
      * Currently uses Uniform Spherical Sampling.
@@ -66,6 +75,13 @@ public:
      */
 
     virtual glm::vec3 sample_li(const glm::vec3& origin, glm::vec3& wi, float& pdf, float& distance) const override {
+        // Case 0: Dedicated environment map store
+        if (env_map) {
+            wi = env_map->sample(glm::vec2(random_float(), random_float()), pdf);
+            distance = Infinity;
+            return env_map->eval(wi);
+        }
+
         // Case 1: Importance Sampling with Image Map
         if (distribution) {
             float map_pdf;
@@ -104,6 +120,7 @@ public:
      * @brief PDF of sampling a specific direction.
      */
     virtual float pdf_value(const glm::vec3& origin, const glm::vec3& wi) const override {
+        if (env_map) return env_map->pdf(wi);
         if (distribution) {
             glm::vec3 dir = glm::normalize(wi);
             float u, v;
@@ -129,6 +146,7 @@ public:
      * @return glm::vec3 The radiance/color from the environment in that direction.
      */
     glm::vec3 eval(const glm::vec3& dir) const {
+        if (env_map) return env_map->eval(dir);
         float u, v;
         glm::vec3 unit_dir = glm::normalize(dir);
         get_sphere_uv(unit_dir, u, v);
@@ -137,5 +155,6 @@ public:
 
 public:
     std::shared_ptr<Texture> texture;
+    std::shared_ptr<EnvironmentMap> env_map; // Set instead of 'texture' for HDR maps loaded via Scene::set_environment
     std::unique_ptr<Distribution2D> distribution;
 };
\ No newline at end of file
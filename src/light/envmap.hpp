@@ -0,0 +1,283 @@
+#pragma once
+
+#include "../core/utils.hpp"
+#include "../core/distribution.hpp"
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "stb_image.h"
+
+/**
+ * @brief Radiance store dedicated to HDR environment maps.
+ *
+ * The equirectangular image is resampled once into an equal-area octahedral square and packed as
+ * RGBE (4 bytes per texel instead of 12), so lookups are a non-virtual bilinear fetch on a compact array.
+ * Because the parameterization is equal-area, the importance sampling distribution needs no sin(theta)
+ * weighting and its PDF converts to solid angle by a constant 1 / (4 * PI).
+ *
+ * The distribution tables can be cached next to the image ("<file>.envcdf") and are reused as long as
+ * the source file size, modification time and resolutions match.
+ */
+class EnvironmentMap {
+public:
+    /**
+     * @param filename Path to the .hdr (or any stb_image readable) file.
+     * @param use_cdf_cache Read / write the sampling distribution from / to "<filename>.envcdf".
+     */
+    EnvironmentMap(const std::string& filename, bool use_cdf_cache = true) {
+        int w, h, comp;
+        float* src = stbi_loadf(filename.c_str(), &w, &h, &comp, 3);
+        if (!src) {
+            std::cerr << "ERROR: Could not load environment map '" << filename << "'.\n";
+            return;
+        }
+
+        // Keep roughly the source texel count
+        resolution = std::clamp(static_cast<int>(std::sqrt(float(w) * float(h))), ENV_MAP_MIN_RESOLUTION, ENV_MAP_MAX_RESOLUTION);
+        resample_equirect(src, w, h);
+        stbi_image_free(src);
+
+        std::string cache_path = filename + ".envcdf";
+        if (!use_cdf_cache || !load_distribution(filename, cache_path)) {
+            build_distribution();
+            if (use_cdf_cache) save_distribution(filename, cache_path);
+        }
+
+        std::cout << "[EnvMap] " << filename << ": " << resolution << "^2 octahedral RGBE texels, "
+                  << distribution->nu << "^2 sampling grid." << std::endl;
+    }
+
+    bool valid() const { return !texels.empty(); }
+
+    /**
+     * @brief Radiance arriving from direction 'dir' (bilinear in octahedral space).
+     */
+    glm::vec3 eval(const glm::vec3& dir) const {
+        if (!valid()) return glm::vec3(1, 0, 1);
+
+        glm::vec2 st = equal_area_sphere_to_square(glm::normalize(dir));
+        float x = st.x * resolution - 0.5f;
+        float y = st.y * resolution - 0.5f;
+        int x0 = static_cast<int>(std::floor(x));
+        int y0 = static_cast<int>(std::floor(y));
+        float s = x - x0;
+        float t = y - y0;
+
+        glm::vec3 c0 = glm::mix(texel(x0, y0), texel(x0 + 1, y0), s);
+        glm::vec3 c1 = glm::mix(texel(x0, y0 + 1), texel(x0 + 1, y0 + 1), s);
+        return glm::mix(c0, c1, t);
+    }
+
+    /**
+     * @brief Importance sample a direction proportionally to the map luminance.
+     * @param u Random numbers in [0, 1)^2.
+     * @param pdf [out] Solid angle PDF of the returned direction.
+     */
+    glm::vec3 sample(const glm::vec2& u, float& pdf) const {
+        if (!distribution) { pdf = 0.0f; return glm::vec3(0.0f, 1.0f, 0.0f); }
+
+        float map_pdf;
+        glm::vec2 st = distribution->sample_continuous(u, map_pdf);
+        pdf = map_pdf / (4.0f * PI);
+        return equal_area_square_to_sphere(st);
+    }
+
+    /**
+     * @brief Solid angle PDF of sampling direction 'dir'.
+     */
+    float pdf(const glm::vec3& dir) const {
+        if (!distribution) return 0.0f;
+        return distribution->pdf(equal_area_sphere_to_square(glm::normalize(dir))) / (4.0f * PI);
+    }
+
+    /**
+     * @brief Luminance integrated over the sphere (used for light selection).
+     */
+    float power() const {
+        return distribution ? distribution->p_marginal->func_int * 4.0f * PI : 0.0f;
+    }
+
+private:
+    int resolution = 0;
+    std::vector<uint32_t> texels; // RGBE, row-major resolution x resolution
+    std::unique_ptr<Distribution2D> distribution;
+
+    struct CacheHeader {
+        char magic[8];
+        uint64_t source_size;
+        int64_t source_mtime;
+        int32_t resolution;
+        int32_t dist_resolution;
+    };
+    static constexpr char CACHE_MAGIC[8] = {'E', 'N', 'V', 'C', 'D', 'F', '0', '1'};
+
+    static uint32_t encode_rgbe(const glm::vec3& c) {
+        float v = std::max({c.r, c.g, c.b});
+        if (v < 1e-32f) return 0;
+        int e;
+        float m = std::frexp(v, &e) * 256.0f / v;
+        uint32_t r = static_cast<uint32_t>(std::max(0.0f, c.r) * m);
+        uint32_t g = static_cast<uint32_t>(std::max(0.0f, c.g) * m);
+        uint32_t b = static_cast<uint32_t>(std::max(0.0f, c.b) * m);
+        return r | (g << 8) | (b << 16) | (uint32_t(e + 128) << 24);
+    }
+
+    static glm::vec3 decode_rgbe(uint32_t rgbe) {
+        // 2^(E - 136) for every exponent byte, computed once
+        static const std::array<float, 256> scale = [] {
+            std::array<float, 256> s{};
+            for (int e = 1; e < 256; ++e) s[e] = std::ldexp(1.0f, e - (128 + 8));
+            return s;
+        }();
+        uint32_t e = rgbe >> 24;
+        if (e == 0) return glm::vec3(0.0f);
+        float f = scale[e];
+        return glm::vec3((float(rgbe & 0xFF) + 0.5f) * f,
+                         (float((rgbe >> 8) & 0xFF) + 0.5f) * f,
+                         (float((rgbe >> 16) & 0xFF) + 0.5f) * f);
+    }
+
+    /**
+     * @brief Fetch a texel; out-of-range indices wrap across the octahedron edges
+     * so that bilinear filtering is seamless on the sphere.
+     */
+    glm::vec3 texel(int x, int y) const {
+        int n = resolution;
+        if (x < 0)       { x = -x - 1;        y = n - 1 - y; }
+        else if (x >= n) { x = 2 * n - 1 - x; y = n - 1 - y; }
+        if (y < 0)       { y = -y - 1;        x = n - 1 - x; }
+        else if (y >= n) { y = 2 * n - 1 - y; x = n - 1 - x; }
+        return decode_rgbe(texels[size_t(y) * n + x]);
+    }
+
+    /**
+     * @brief Resample the equirectangular source into the octahedral square (parallel over rows).
+     * Uses the same (u, v) convention as get_sphere_uv / ImageTexture.
+     */
+    void resample_equirect(const float* src, int w, int h) {
+        texels.resize(size_t(resolution) * resolution);
+
+        auto fetch = [&](int x, int y) {
+            x = ((x % w) + w) % w;        // Longitude wraps around
+            y = std::clamp(y, 0, h - 1);  // Latitude clamps at the poles
+            const float* px = &src[(size_t(y) * w + x) * 3];
+            return glm::vec3(px[0], px[1], px[2]);
+        };
+
+        #pragma omp parallel for schedule(static)
+        for (int y = 0; y < resolution; ++y) {
+            for (int x = 0; x < resolution; ++x) {
+                glm::vec3 dir = equal_area_square_to_sphere(glm::vec2((x + 0.5f) / resolution, (y + 0.5f) / resolution));
+                float u, v;
+                get_sphere_uv(dir, u, v);
+
+                float i = u * w - 0.5f;
+                float j = (1.0f - v) * h - 0.5f; // Flip V to image rows
+                int i0 = static_cast<int>(std::floor(i));
+                int j0 = static_cast<int>(std::floor(j));
+                float s = i - i0;
+                float t = j - j0;
+
+                glm::vec3 c0 = glm::mix(fetch(i0, j0), fetch(i0 + 1, j0), s);
+                glm::vec3 c1 = glm::mix(fetch(i0, j0 + 1), fetch(i0 + 1, j0 + 1), s);
+                texels[size_t(y) * resolution + x] = encode_rgbe(glm::mix(c0, c1, t));
+            }
+        }
+    }
+
+    /**
+     * @brief Average luminance of the texels covered by each cell of the sampling grid (parallel over rows).
+     * The grid is equal-area as well, so no solid angle weighting is required.
+     */
+    void build_distribution() {
+        int m = std::min(resolution, ENV_DISTRIBUTION_RESOLUTION);
+        std::vector<float> luminance(size_t(m) * m);
+
+        #pragma omp parallel for schedule(static)
+        for (int cy = 0; cy < m; ++cy) {
+            int y0 = cy * resolution / m;
+            int y1 = std::max(y0 + 1, (cy + 1) * resolution / m);
+            for (int cx = 0; cx < m; ++cx) {
+                int x0 = cx * resolution / m;
+                int x1 = std::max(x0 + 1, (cx + 1) * resolution / m);
+
+                float sum = 0.0f;
+                for (int y = y0; y < y1; ++y)
+                    for (int x = x0; x < x1; ++x)
+                        sum += grayscale(decode_rgbe(texels[size_t(y) * resolution + x]));
+                luminance[size_t(cy) * m + cx] = sum / float((y1 - y0) * (x1 - x0));
+            }
+        }
+
+        distribution = std::make_unique<Distribution2D>(luminance.data(), m, m);
+    }
+
+    bool load_distribution(const std::string& filename, const std::string& cache_path) {
+        std::ifstream in(cache_path, std::ios::binary);
+        if (!in) return false;
+
+        CacheHeader header;
+        uint64_t size;
+        int64_t mtime;
+        int m = std::min(resolution, ENV_DISTRIBUTION_RESOLUTION);
+        if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))
+            || std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0
+            || !file_stamp(filename, size, mtime)
+            || header.source_size != size || header.source_mtime != mtime
+            || header.resolution != resolution || header.dist_resolution != m) {
+            return false;
+        }
+
+        size_t cells = size_t(m) * m;
+        std::vector<float> func(cells);
+        std::vector<AliasBin> conditional(cells);
+        std::vector<float> row_int(m);
+        if (!in.read(reinterpret_cast<char*>(func.data()), cells * sizeof(float))
+            || !in.read(reinterpret_cast<char*>(conditional.data()), cells * sizeof(AliasBin))
+            || !in.read(reinterpret_cast<char*>(row_int.data()), m * sizeof(float))) {
+            return false;
+        }
+
+        distribution = std::make_unique<Distribution2D>(m, m, std::move(func), std::move(conditional), std::move(row_int));
+        std::cout << "[EnvMap] Loaded sampling distribution from " << cache_path << std::endl;
+        return true;
+    }
+
+    void save_distribution(const std::string& filename, const std::string& cache_path) const {
+        CacheHeader header;
+        std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+        if (!file_stamp(filename, header.source_size, header.source_mtime)) return;
+        header.resolution = resolution;
+        header.dist_resolution = distribution->nu;
+
+        // Loaded on the task graph: write a private file and rename it into place, so another run
+        // reading the same map never sees a partial cache
+        std::ostringstream tmp_name;
+        tmp_name << cache_path << ".tmp" << std::this_thread::get_id();
+        const std::string tmp_path = tmp_name.str();
+        std::ofstream out(tmp_path, std::ios::binary);
+        if (!out) {
+            std::cerr << "[EnvMap] Warning: cannot write distribution cache " << cache_path << std::endl;
+            return;
+        }
+        size_t cells = distribution->func.size();
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(distribution->func.data()), cells * sizeof(float));
+        out.write(reinterpret_cast<const char*>(distribution->conditional.data()), cells * sizeof(AliasBin));
+        out.write(reinterpret_cast<const char*>(distribution->row_int.data()), distribution->row_int.size() * sizeof(float));
+
+        out.close();
+        std::error_code ec;
+        if (out.fail()) std::filesystem::remove(tmp_path, ec);
+        else std::filesystem::rename(tmp_path, cache_path, ec);
+        if (ec || out.fail()) std::cerr << "[EnvMap] Warning: cannot write distribution cache " << cache_path << std::endl;
+    }
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../core/utils.hpp"
+#include "../core/record.hpp"
 #include <glm/glm.hpp>
 #include <memory>
 
@@ -31,6 +32,14 @@ public:
      */
     virtual float pdf_value(const glm::vec3& origin, const glm::vec3& wi) const = 0;
 
+    /**
+     * @brief Same as pdf_value, for when the ray (origin, wi) is already known to hit this light at 'rec'.
+     * Lights backed by geometry override this to evaluate the PDF analytically instead of re-intersecting.
+     */
+    virtual float pdf_value(const glm::vec3& origin, const glm::vec3& wi, const HitRecord& rec) const {
+        return pdf_value(origin, wi);
+    }
+
     /**
      * @brief emit a photon
      * @param p_pos [out] start point
@@ -67,6 +76,11 @@ public:
      */
     virtual float power() const {return est_power;}
 
+    /**
+     * @brief Re-estimate cached quantities (the power) after the emitter was edited.
+     */
+    virtual void refresh() {}
+
 protected:
     float est_power = 1.0f;
 };
\ No newline at end of file
@@ -63,11 +63,11 @@ public:
         glm::vec3& p_pos, glm::vec3& p_dir, glm::vec3& p_power, float total_photons, const Object& target
     ) const override {
         p_pos = position;
-        glm::vec3 vec_to_target = target.random_pointing_vector(p_pos);
+        float pdf_dir;
+        glm::vec3 vec_to_target = target.random_pointing_vector(p_pos, pdf_dir);
         float dist = glm::length(vec_to_target);
         if (dist <= EPSILON) return false;
         p_dir = vec_to_target / dist;
-        float pdf_dir = target.pdf_value(p_pos, p_dir);
         if (pdf_dir <= EPSILON) return false;
         // Power_new = Power_old * Weight 
         //           = (Intensity * 4PI / N) * (1 / (4PI * target_pdf))
@@ -7,8 +7,11 @@
 #include <iomanip>
 #include <sstream>
 #include <atomic>
+#include <chrono>
 #include <mutex>
 #include <cmath>
+#include <cstring>
+#include <fstream>
 
 // External
 #include <glm/glm.hpp>
@@ -18,14 +21,34 @@
 // Project Headers
 #include "core/utils.hpp"
 #include "core/ray.hpp"
+#include "core/numa.hpp"
 #include "scene/scene.hpp"
 #include "scene/camera.hpp"
-#include "renderer/path_integrator.hpp"
-#include "renderer/photon_integrator.hpp"
+#include "renderer/integrator_factory.hpp"
 
 // Scene List
 #include "scene_list.cpp"
 
+/**
+ * @brief One camera of a multi-view job. Its images are named after it (empty: the plain scene names).
+ */
+struct ViewJob {
+    std::string name;
+    Camera camera;
+};
+
+/**
+ * @brief Part of the image to (re-)render: a pixel rectangle, optionally narrowed by a mask image
+ * whose non-zero pixels are rendered. Nothing set = the whole image.
+ */
+struct CropRegion {
+    int x = 0, y = 0;           // Top-left pixel (rows counted from the top, as in the output images)
+    int width = 0, height = 0;  // 0 = up to the image border
+    std::string mask;           // Optional grayscale image of the film's size
+
+    bool enabled() const { return x > 0 || y > 0 || width > 0 || height > 0 || !mask.empty(); }
+};
+
 struct RenderConfig {
     // --- Basic Image Settings ---
     int width;
@@ -48,10 +71,32 @@ struct RenderConfig {
     int num_photons;
     float caustic_radius;
     float global_radius;
+    float volume_radius;    // Maximum volume photon radius (beam radiance estimate), 0 = off
     int k_nearest;
     int final_gather_bound;
+
+    // --- Texture Cache ---
+    int texture_cache_mb;   // Memory budget for lazily paged texture tiles
+
+    // --- Multi-View ---
+    std::vector<ViewJob> views = {}; // Extra cameras sharing the scene, BVH and photon maps; empty = the scene camera
+    bool concurrent_views = true;    // Interleave all views in each batch instead of rendering them one by one
+
+    // --- Animation ---
+    int frame_count = 0;             // > 0: render this many frames of the scene's Animation tracks
+
+    // --- Edit Session ---
+    bool render_edits = false;       // After the render, apply the scene's edits one by one and re-render incrementally
+
+    // --- Render Region ---
+    CropRegion region = {};          // Only sample this region and merge into the saved raw film (see ViewFilm::load)
+
+    // --- Time Budget ---
+    double time_budget = 0.0;        // Wall-clock seconds for the whole run (0 = none); samples_per_pixel stays the cap
 };
 
+using RenderClock = std::chrono::steady_clock;
+
 // 默认配置生成器
 RenderConfig get_default_config() {
     return {
@@ -59,7 +104,8 @@ RenderConfig get_default_config() {
         5000, 50, 10,           // samples (max), batch, depth
         true, 0.01f, 64,        // [Dynamic] adaptive=true, threshold=0.01, min=64
         false,                  // use_photon_mapping
-        5000000, 0.1f, 0.4f, 200, 4 // default photon settings
+        5000000, 0.1f, 0.4f, 0.0f, 200, 4, // default photon settings
+        TEXTURE_CACHE_DEFAULT_MB    // texture cache budget (MB)
     };
 }
 
@@ -67,6 +113,14 @@ RenderConfig get_default_config() {
 // SCENE SELECTION
 // ==========================
 const int SCENE_ID = 7;
+const float STEREO_EYE_DISTANCE = 0.0f; // > 0: render a left/right pair this far apart instead of the scene camera
+
+/**
+ * @brief Parallel stereo pair around 'cam'.
+ */
+std::vector<ViewJob> stereo_views(const Camera& cam, float eye_distance) {
+    return {{"left", cam.shifted(-0.5f * eye_distance)}, {"right", cam.shifted(0.5f * eye_distance)}};
+}
 
 float get_luminance(const glm::vec3& color) {
     return glm::dot(color, glm::vec3(0.2126f, 0.7152f, 0.0722f));
@@ -90,11 +144,20 @@ void draw_progress_bar(int current, int total, int batch_idx, int active_px) {
     std::cout << ss.str() << std::flush;
 }
 
-std::string generate_filename(int scene_id, bool is_heatmap, const std::string& method, int spp, bool is_latest) {
+/**
+ * @brief Raw film checkpoint: scene_[num]_[PT/PM]_[view_]film.raw
+ */
+std::string film_filename(int scene_id, const std::string& method, const std::string& view = "") {
+    return "scene_" + std::to_string(scene_id) + "_" + method + "_" + (view.empty() ? "" : view + "_") + "film.raw";
+}
+
+std::string generate_filename(int scene_id, bool is_heatmap, const std::string& method, int spp, bool is_latest,
+                              const std::string& view = "") {
     std::stringstream ss;
-    // scene_[num]_[PT/PM]_[heatmap/output]_samples_[SPP].png
+    // scene_[num]_[PT/PM]_[view_][heatmap/output]_samples_[SPP].png
     ss << "scene_" << scene_id << "_"
        << method << "_"
+       << (view.empty() ? "" : view + "_")
        << (is_heatmap ? "heatmap" : "output") << "_samples_";
     
     if (is_latest) {
@@ -111,12 +174,14 @@ std::string generate_filename(int scene_id, bool is_heatmap, const std::string&
  * @param current_spp 
  * @param method_tag "PT" or "PM"
  * @param is_milestone
+ * @param view Name of the view (empty for single-view renders)
  */
 void save_snapshot(int current_spp, int width, int height, 
-                   const std::vector<glm::vec3>& accum_buffer,
-                   const std::vector<int>& pixel_counts,
+                   const NumaVector<glm::vec3>& accum_buffer,
+                   const NumaVector<int>& pixel_counts,
                    const std::string& method_tag,
-                   bool is_milestone) {
+                   bool is_milestone,
+                   const std::string& view = "") {
     
     std::vector<unsigned char> image_output(width * height * 3);
     std::vector<unsigned char> heatmap_output(width * height * 3);
@@ -146,15 +211,15 @@ void save_snapshot(int current_spp, int width, int height,
         }
     }
 
-    std::string latest_img_name = generate_filename(SCENE_ID, false, method_tag, current_spp, true);
-    std::string latest_heat_name = generate_filename(SCENE_ID, true, method_tag, current_spp, true);
+    std::string latest_img_name = generate_filename(SCENE_ID, false, method_tag, current_spp, true, view);
+    std::string latest_heat_name = generate_filename(SCENE_ID, true, method_tag, current_spp, true, view);
 
     stbi_write_png(latest_img_name.c_str(), width, height, 3, image_output.data(), width * 3);
     stbi_write_png(latest_heat_name.c_str(), width, height, 3, heatmap_output.data(), width * 3);
 
     if (is_milestone) {
-        std::string mile_img_name = generate_filename(SCENE_ID, false, method_tag, current_spp, false);
-        std::string mile_heat_name = generate_filename(SCENE_ID, true, method_tag, current_spp, false);
+        std::string mile_img_name = generate_filename(SCENE_ID, false, method_tag, current_spp, false, view);
+        std::string mile_heat_name = generate_filename(SCENE_ID, true, method_tag, current_spp, false, view);
         
         stbi_write_png(mile_img_name.c_str(), width, height, 3, image_output.data(), width * 3);
         stbi_write_png(mile_heat_name.c_str(), width, height, 3, heatmap_output.data(), width * 3);
@@ -163,11 +228,392 @@ void save_snapshot(int current_spp, int width, int height,
     }
 }
 
+/**
+ * @brief Accumulation buffers and progress of one view.
+ */
+struct ViewFilm {
+    ViewJob view;
+    int width, height;
+
+    // Row bands live on the node whose threads render them (NumaRowScheduler hands out the same bands)
+    NumaVector<glm::vec3> accumulation_buffer;
+    NumaVector<glm::vec3> accumulation_buffer_sq;
+    NumaVector<int> pixel_samples;
+    std::vector<uint8_t> pixel_converged; // Converged or outside the region. Bytes: neighbouring rows are written concurrently
+
+    int x0 = 0, y0 = 0, x1 = 0, y1 = 0;   // Pixel window that is sampled, [x0, x1) x [y0, y1)
+    std::vector<int> sample_quota;        // Per-pixel samples of the next batch instead of the batch size (empty = none)
+    std::atomic<int> total_active_pixels;
+    std::atomic<long long> samples_taken;
+    int samples_loop_count = 0;
+    int next_save_milestone = 0;
+    bool done = false;
+
+    ViewFilm(const ViewJob& v, int w, int h, int first_milestone)
+        : view(v), width(w), height(h),
+          accumulation_buffer(w * h, NumaPlacement::Block),
+          accumulation_buffer_sq(w * h, NumaPlacement::Block),
+          pixel_samples(w * h, NumaPlacement::Block),
+          pixel_converged(w * h) {
+        reset(v, first_milestone);
+    }
+
+    /**
+     * @brief Restart accumulation for 'v' (after a scene edit or for the next frame).
+     * The buffers are cleared in place, so they keep their pages and NUMA placement.
+     */
+    void reset(const ViewJob& v, int first_milestone) {
+        view = v;
+        view.camera.set_image_height(height); // Ray cone spread for MIP-mapped textures
+        std::fill(accumulation_buffer.begin(), accumulation_buffer.end(), glm::vec3(0.0f));
+        std::fill(accumulation_buffer_sq.begin(), accumulation_buffer_sq.end(), glm::vec3(0.0f));
+        std::fill(pixel_samples.begin(), pixel_samples.end(), 0);
+        std::fill(pixel_converged.begin(), pixel_converged.end(), uint8_t(0));
+        x0 = y0 = 0;
+        x1 = width;
+        y1 = height;
+        sample_quota.clear();
+        total_active_pixels = width * height;
+        samples_taken = 0;
+        samples_loop_count = 0;
+        next_save_milestone = first_milestone;
+        done = false;
+    }
+
+    /**
+     * @brief Sample only 'region' from now on: rows outside its window are never scheduled and
+     * masked-out pixels inside it are skipped, so a pass costs in proportion to the region.
+     */
+    void restrict_to(const CropRegion& region) {
+        x0 = std::clamp(region.x, 0, width);
+        y0 = std::clamp(region.y, 0, height);
+        x1 = region.width > 0 ? std::min(width, x0 + region.width) : width;
+        y1 = region.height > 0 ? std::min(height, y0 + region.height) : height;
+
+        std::vector<uint8_t> mask;
+        if (!region.mask.empty()) {
+            int w, h, channels;
+            unsigned char* data = stbi_load(region.mask.c_str(), &w, &h, &channels, 1);
+            if (!data || w != width || h != height) {
+                std::cerr << "ERROR: Region mask " << region.mask << " missing or not " << width << "x" << height
+                          << ", using the rectangle only." << std::endl;
+            } else {
+                mask.assign(data, data + size_t(w) * h);
+            }
+            stbi_image_free(data);
+        }
+
+        int active = 0;
+        for (int j = 0; j < height; ++j) {
+            for (int i = 0; i < width; ++i) {
+                int index = j * width + i;
+                bool inside = i >= x0 && i < x1 && j >= y0 && j < y1 && (mask.empty() || mask[index] > 0);
+                pixel_converged[index] = inside ? 0 : 1;
+                active += inside ? 1 : 0;
+            }
+        }
+        total_active_pixels = active;
+        std::cout << "[Region] " << (x1 - x0) << "x" << (y1 - y0) << " window at (" << x0 << ", " << y0 << "), "
+                  << active << " px" << std::endl;
+    }
+
+    /**
+     * @brief Write the raw sums (not the tone mapped image), so a later pass can continue from them.
+     */
+    bool save(const std::string& path) const {
+        std::ofstream out(path, std::ios::binary);
+        if (!out) return false;
+        const int32_t header[2] = {width, height};
+        out.write(FILM_MAGIC, sizeof(FILM_MAGIC));
+        out.write(reinterpret_cast<const char*>(header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(accumulation_buffer.data()), accumulation_buffer.size() * sizeof(glm::vec3));
+        out.write(reinterpret_cast<const char*>(accumulation_buffer_sq.data()), accumulation_buffer_sq.size() * sizeof(glm::vec3));
+        out.write(reinterpret_cast<const char*>(pixel_samples.data()), pixel_samples.size() * sizeof(int));
+        return bool(out);
+    }
+
+    /**
+     * @brief Continue from a film written by save(); new samples are added to its sums.
+     * @return False (film left empty) if the file is missing or of another resolution.
+     */
+    bool load(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) return false;
+        char magic[sizeof(FILM_MAGIC)];
+        int32_t header[2];
+        in.read(magic, sizeof(magic));
+        in.read(reinterpret_cast<char*>(header), sizeof(header));
+        if (!in || std::memcmp(magic, FILM_MAGIC, sizeof(magic)) != 0 || header[0] != width || header[1] != height) {
+            std::cerr << "ERROR: " << path << " is not a " << width << "x" << height << " film, starting empty." << std::endl;
+            return false;
+        }
+        in.read(reinterpret_cast<char*>(accumulation_buffer.data()), accumulation_buffer.size() * sizeof(glm::vec3));
+        in.read(reinterpret_cast<char*>(accumulation_buffer_sq.data()), accumulation_buffer_sq.size() * sizeof(glm::vec3));
+        in.read(reinterpret_cast<char*>(pixel_samples.data()), pixel_samples.size() * sizeof(int));
+        if (!in) {
+            std::cerr << "ERROR: " << path << " is truncated, starting empty." << std::endl;
+            reset(view, next_save_milestone);
+            return false;
+        }
+        std::cout << "[Film] Merging into " << path << std::endl;
+        return true;
+    }
+
+private:
+    static constexpr char FILM_MAGIC[8] = {'R', 'A', 'W', 'F', 'I', 'L', 'M', '1'};
+};
+
+/**
+ * @brief Standard error of the pixel's mean luminance, the adaptive sampling criterion.
+ */
+float pixel_error(const ViewFilm& film, int index) {
+    float N = float(film.pixel_samples[index]);
+    if (N == 0.0f) return 0.0f;
+
+    glm::vec3 mean = film.accumulation_buffer[index] / N;
+    glm::vec3 mean_sq = film.accumulation_buffer_sq[index] / N;
+
+    // Var(X) = E[X^2] - (E[X])^2
+    float lum_mean = get_luminance(mean);
+    float lum_mean_sq = get_luminance(mean_sq);
+    float variance = std::abs(lum_mean_sq - lum_mean * lum_mean);
+
+    // Standard Error (Standard Deviation of the Mean)
+    // Error = sqrt(Variance / N)
+    return std::sqrt(variance / N);
+}
+
+/**
+ * @brief Render 'batch_size' samples (or the film's sample quota) for every active pixel of row j.
+ * @return Number of pixels that were still active.
+ */
+int render_row(ViewFilm& film, int j, int batch_size, const RenderConfig& config,
+               const Scene& world, const Integrator& integrator) {
+    const int width = film.width;
+    const int height = film.height;
+    int row_processed_count = 0;
+    long long row_samples = 0;
+
+    for (int i = film.x0; i < film.x1; ++i) {
+        int index = j * width + i;
+
+        if (film.pixel_converged[index]) {
+            continue;
+        }
+        row_processed_count++;
+
+        const int pixel_batch = film.sample_quota.empty() ? batch_size : film.sample_quota[index];
+        if (pixel_batch == 0) continue;
+        row_samples += pixel_batch;
+
+        glm::vec3 batch_color(0.0f);
+        glm::vec3 batch_color_sq(0.0f);
+
+        // Run the samples for this batch
+        for (int s = 0; s < pixel_batch; ++s) {
+            float u = (float(i) + random_float()) / width;
+            float v = (float(height - 1 - j) + random_float()) / height;
+
+            Ray r = film.view.camera.get_ray(u, v);
+            glm::vec3 rad = integrator.estimate_radiance(r, world);
+            
+            if (glm::any(glm::isnan(rad)) || glm::any(glm::isinf(rad))) rad = glm::vec3(0.0f);
+
+            batch_color += rad;
+            batch_color_sq += rad * rad;
+        }
+
+        // Update Buffers (Thread-safe due to distinct i, j ownership)
+        film.accumulation_buffer[index] += batch_color;
+        film.accumulation_buffer_sq[index] += batch_color_sq;
+        film.pixel_samples[index] += pixel_batch;
+
+        // --- Adaptive Sampling Convergence Check ---
+        if (config.use_adaptive_sampling && film.pixel_samples[index] >= config.min_samples) {
+            if (pixel_error(film, index) < config.adaptive_threshold) {
+                film.pixel_converged[index] = 1;
+                film.total_active_pixels--;
+            }
+        }
+    }
+    film.samples_taken += row_samples;
+    return row_processed_count;
+}
+
+/**
+ * @brief Spread 'capacity' samples over the active pixels of 'films' in proportion to their error,
+ * as the films' sample quotas (stochastically rounded, capped by samples_per_pixel).
+ * @return Samples actually allotted.
+ */
+long long allot_by_error(const std::vector<ViewFilm*>& films, long long capacity, const RenderConfig& config) {
+    double error_sum = 0.0;
+    int active_pixels = 0;
+    for (ViewFilm* film : films) {
+        for (int j = film->y0; j < film->y1; ++j)
+            for (int i = film->x0; i < film->x1; ++i)
+                if (!film->pixel_converged[j * film->width + i]) error_sum += pixel_error(*film, j * film->width + i);
+        active_pixels += film->total_active_pixels.load();
+    }
+
+    long long allotted = 0;
+    for (ViewFilm* film : films) {
+        film->sample_quota.assign(size_t(film->width) * film->height, 0);
+        for (int j = film->y0; j < film->y1; ++j) {
+            for (int i = film->x0; i < film->x1; ++i) {
+                const int index = j * film->width + i;
+                if (film->pixel_converged[index]) continue;
+                // Nothing measured yet (all pixels black): spread evenly
+                const double share = error_sum > 0.0 ? pixel_error(*film, index) / error_sum
+                                                     : 1.0 / std::max(1, active_pixels);
+                const int quota = int(double(capacity) * share + random_float());
+                film->sample_quota[index] = std::min(quota, std::max(0, config.samples_per_pixel - film->pixel_samples[index]));
+                allotted += film->sample_quota[index];
+            }
+        }
+    }
+    return allotted;
+}
+
+/**
+ * @brief Batched progressive rendering of several views against one scene and integrator.
+ * Each batch covers every unfinished view inside one parallel region: a thread that runs out of
+ * rows in one view moves on to the next without waiting, so small views don't leave cores idle.
+ *
+ * With a deadline, the first batch takes one sample per pixel to measure the throughput. Full
+ * batches follow while they are predicted to fit; the last batch spreads the remaining capacity
+ * over the active pixels by error, and the final outputs are written before the deadline.
+ */
+void render_views(const std::vector<ViewFilm*>& films, const RenderConfig& config,
+                  const Scene& world, const Integrator& integrator, const std::string& method_tag,
+                  RenderClock::time_point deadline = RenderClock::time_point::max()) {
+    const bool budgeted = deadline != RenderClock::time_point::max();
+    double seconds_per_sample = 0.0; // Measured over the last batch, all threads together
+    double snapshot_seconds = 0.0;   // Longest measured snapshot write
+    bool last_batch = false;
+
+    // --- RENDER LOOP (Batched) ---
+    while (!last_batch) {
+        std::vector<ViewFilm*> active;
+        int start_active_count = 0;
+        for (ViewFilm* film : films) {
+            if (film->done) continue;
+            if (film->samples_loop_count >= config.samples_per_pixel) { film->done = true; continue; }
+            if (film->total_active_pixels.load() == 0) {
+                std::cout << "\nAll pixels" << (film->view.name.empty() ? "" : " of view '" + film->view.name + "'")
+                          << " converged! Stopping early." << std::endl;
+                film->done = true;
+                continue;
+            }
+            active.push_back(film);
+            start_active_count += film->total_active_pixels.load();
+        }
+        if (active.empty()) break;
+
+        std::vector<int> batch_sizes;
+        std::vector<std::unique_ptr<NumaRowScheduler>> rows;
+        for (ViewFilm* film : active) {
+            batch_sizes.push_back(std::min(config.samples_per_batch, config.samples_per_pixel - film->samples_loop_count));
+            rows.push_back(std::make_unique<NumaRowScheduler>(film->y1 - film->y0)); // Only the region's rows
+        }
+
+        // --- TIME BUDGET ---
+        if (budgeted) {
+            const double remaining = std::chrono::duration<double>(deadline - RenderClock::now()).count()
+                                   - TIME_BUDGET_RESERVE * snapshot_seconds;
+            long long full_batch = 0;
+            for (size_t f = 0; f < active.size(); ++f) full_batch += (long long)active[f]->total_active_pixels.load() * batch_sizes[f];
+
+            if (remaining <= 0.0) {
+                std::cout << "\n[Budget] Deadline reached, writing final outputs." << std::endl;
+                break;
+            }
+            if (seconds_per_sample == 0.0) {
+                std::fill(batch_sizes.begin(), batch_sizes.end(), 1); // Probe batch
+            } else if (remaining < full_batch * seconds_per_sample) {
+                const long long capacity = (long long)(TIME_BUDGET_SAFETY * remaining / seconds_per_sample);
+                const long long allotted = allot_by_error(active, capacity, config);
+                std::cout << "\n[Budget] " << std::fixed << std::setprecision(1) << remaining << "s left at "
+                          << std::setprecision(0) << 1.0 / seconds_per_sample << " samples/s: last batch spreads "
+                          << allotted << " samples over " << start_active_count << " px by error." << std::endl;
+                std::cout.unsetf(std::ios::floatfield);
+                for (size_t f = 0; f < active.size(); ++f) {
+                    const int pixels = std::max(1, active[f]->total_active_pixels.load());
+                    long long film_samples = 0;
+                    for (int quota : active[f]->sample_quota) film_samples += quota;
+                    batch_sizes[f] = int((film_samples + pixels - 1) / pixels); // Mean, for the output names
+                }
+                last_batch = true;
+            }
+        }
+        const int batch_idx = active[0]->samples_loop_count + batch_sizes[0];
+
+        auto active_pixels = [&]() {
+            int count = 0;
+            for (ViewFilm* film : active) count += film->total_active_pixels.load();
+            return count;
+        };
+
+        std::atomic<int> processed_active_pixels{0};
+        long long samples_before = 0;
+        for (ViewFilm* film : active) samples_before += film->samples_taken.load();
+        const auto batch_start = RenderClock::now();
+
+        // Parallelize pixel loops: rows of the thread's own NUMA band first, then stolen ones
+        #pragma omp parallel
+        for (size_t f = 0; f < active.size(); ++f) {
+            for (int row; rows[f]->next(omp_get_thread_num(), omp_get_num_threads(), row);) {
+                int row_processed_count = render_row(*active[f], active[f]->y0 + row, batch_sizes[f], config, world, integrator);
+                
+                if (row_processed_count > 0) {
+                    int current_processed = (processed_active_pixels += row_processed_count);
+                    if (omp_get_thread_num() == 0) {
+                         draw_progress_bar(current_processed, start_active_count, batch_idx, active_pixels());
+                    }
+                }
+            }
+        }
+        draw_progress_bar(start_active_count, start_active_count, batch_idx, active_pixels());
+        std::cout << std::flush;
+
+        const auto batch_end = RenderClock::now();
+        long long batch_samples = -samples_before;
+        for (ViewFilm* film : active) batch_samples += film->samples_taken.load();
+        if (batch_samples > 0) seconds_per_sample = std::chrono::duration<double>(batch_end - batch_start).count() / batch_samples;
+
+        for (size_t f = 0; f < active.size(); ++f) {
+            ViewFilm& film = *active[f];
+            film.samples_loop_count += batch_sizes[f];
+
+            bool is_milestone = false;
+            if (film.samples_loop_count >= film.next_save_milestone) {
+                is_milestone = true;
+                film.next_save_milestone *= 2;
+            }
+
+            save_snapshot(film.samples_loop_count, film.width, film.height, film.accumulation_buffer,
+                          film.pixel_samples, method_tag, is_milestone, film.view.name);
+            if (is_milestone) film.save(film_filename(SCENE_ID, method_tag, film.view.name));
+            film.sample_quota.clear();
+        }
+        std::cout << std::flush;
+        snapshot_seconds = std::max(snapshot_seconds, std::chrono::duration<double>(RenderClock::now() - batch_end).count());
+    }
+
+    for (ViewFilm* film : films) {
+        save_snapshot(film->samples_loop_count, film->width, film->height, film->accumulation_buffer,
+                      film->pixel_samples, method_tag, true, film->view.name);
+        film->save(film_filename(SCENE_ID, method_tag, film->view.name));
+    }
+}
+
 int main() {
+    const auto run_start = RenderClock::now();
 
     Scene world;
     Camera cam(glm::vec3(0), glm::vec3(0,0,-1), glm::vec3(0,1,0), 90, 16.0f/9.0f); 
     RenderConfig config = get_default_config();
+    Animation animation;
+    std::vector<SceneEdit> edits;
 
     switch (SCENE_ID) {
         case 1: scene_materials_textures(world, cam, config.aspect_ratio); break;
@@ -178,6 +624,7 @@ int main() {
             config.num_photons = 50000000;
             config.caustic_radius = 1.0f;
             config.global_radius = 4.0f;
+            config.volume_radius = 10.0f;
             config.k_nearest = 200;
             config.final_gather_bound = 5;
             scene_cornell_smoke_caustics(world, cam, config.aspect_ratio);
@@ -202,148 +649,124 @@ int main() {
             config.global_radius = 0.4f;
             config.k_nearest = 100;
             config.final_gather_bound = 5;
-            scene_prism_spectrum(world, cam, config.aspect_ratio);
+            scene_prism_spectrum(world, cam, config.aspect_ratio, &edits);
+            break;
+        case 8: scene_newton_test(world, cam, config.aspect_ratio, &animation); break;
+        case 9:
+            config.frame_count = 36;
+            config.samples_per_pixel = 256;
+            scene_newton_orbit(world, cam, config.aspect_ratio, animation);
             break;
-        case 8: scene_newton_test(world, cam, config.aspect_ratio); break;
+        case 10: scene_smoke_plume(world, cam, config.aspect_ratio); break;
         default: scene_materials_textures(world, cam, config.aspect_ratio); break;
     }
 
     const int width = config.width; 
     const int height = static_cast<int>(width / config.aspect_ratio); 
+    TextureCache::instance().set_capacity(size_t(config.texture_cache_mb) << 20);
     std::string method_tag = config.use_photon_mapping ? "PM" : "PT";
     
     std::cout << "Rendering Scene ID: " << SCENE_ID << " [" << width << "x" << height << "]" << std::endl;
     std::cout << "Max Samples: " << config.samples_per_pixel << " (Batch: " << config.samples_per_batch << ")" << std::endl;
     std::cout << "Adaptive Sampling: " << (config.use_adaptive_sampling ? "ON" : "OFF") << std::endl;
 
-    world.build_bvh(0.0f, 1.0f); 
-
-    std::unique_ptr<Integrator> integrator;
-
-    if (config.use_photon_mapping) {
-        std::cout << "Using Photon Integrator..." << std::endl;
-        integrator = std::make_unique<PhotonIntegrator>(
-            config.max_depth,
-            config.num_photons,
-            config.caustic_radius,
-            config.global_radius,
-            config.k_nearest,
-            config.final_gather_bound,
-            0.0f, 1.0f, world
-        );
-    } else {
-        std::cout << "Using Path Integrator (MIS + NEE)..." << std::endl;
-        integrator = std::make_unique<PathIntegrator>(config.max_depth, world);
+    world.build_bvh(0.0f, 1.0f); // Joins the mesh and environment map loads still running on the task graph
+    if (config.frame_count > 0) {
+        animation.apply(0, config.frame_count, world, cam);
+        world.commit_changes(0.0f, 1.0f); // The integrator is built from the first frame
     }
 
-    // --- BUFFERS ---
-    std::vector<glm::vec3> accumulation_buffer(width * height, glm::vec3(0.0f));
-    
-    std::vector<glm::vec3> accumulation_buffer_sq(width * height, glm::vec3(0.0f));
-
-    std::vector<int> pixel_samples(width * height, 0);
-
-    std::vector<bool> pixel_converged(width * height, false);
-
-    std::atomic<int> total_active_pixels(width * height);
-    int samples_loop_count = 0;
-    int next_save_milestone = config.samples_per_batch; 
-
-    // --- RENDER LOOP (Batched) ---
-    while (samples_loop_count < config.samples_per_pixel) {
-        
-        int start_active_count = total_active_pixels.load();
-        if (start_active_count == 0) {
-            std::cout << "\nAll pixels converged! Stopping early." << std::endl;
-            break;
+    IntegratorSettings settings;
+    settings.use_photon_mapping = config.use_photon_mapping;
+    settings.max_depth = config.max_depth;
+    settings.num_photons = config.num_photons;
+    settings.caustic_radius = config.caustic_radius;
+    settings.global_radius = config.global_radius;
+    settings.volume_radius = config.volume_radius;
+    settings.k_nearest = config.k_nearest;
+    settings.final_gather_bound = config.final_gather_bound;
+    settings.time0 = 0.0f;
+    settings.time1 = 1.0f;
+    NumaTopology::instance().pin_openmp_threads(); // Before photon emission, so the team keeps its sockets
+    std::unique_ptr<Integrator> integrator = make_integrator(settings, world);
+    TextureRegistry::instance().wait(); // Textures kept converting (or decoding) during the BVH build and photon emission
+
+    // --- TIME BUDGET (counted from startup, shared evenly by the passes still to render) ---
+    const bool budgeted = config.time_budget > 0.0;
+    const auto run_deadline = run_start + std::chrono::duration_cast<RenderClock::duration>(std::chrono::duration<double>(config.time_budget));
+    int passes_left = std::max(1, config.frame_count) + (config.render_edits ? int(edits.size()) : 0);
+    auto share_until = [&](RenderClock::time_point end, int parts) {
+        if (!budgeted) return RenderClock::time_point::max();
+        const auto now = RenderClock::now();
+        return end <= now ? now : now + (end - now) / std::max(1, parts);
+    };
+    if (budgeted) std::cout << "Time Budget: " << config.time_budget << "s" << std::endl;
+
+    // --- FILMS (one per view, allocated once and cleared between passes) ---
+    std::vector<std::unique_ptr<ViewFilm>> films;
+    auto render_pass = [&](const std::string& tag) {
+        const auto pass_deadline = share_until(run_deadline, passes_left--);
+        // Scene, BVH, light distribution and photon maps are shared by all views
+        std::vector<ViewJob> views = config.views;
+        if (views.empty()) {
+            views = STEREO_EYE_DISTANCE > 0.0f ? stereo_views(cam, STEREO_EYE_DISTANCE)
+                                               : std::vector<ViewJob>{{"", cam}};
         }
-
-        int current_batch_size = std::min(config.samples_per_batch, config.samples_per_pixel - samples_loop_count);
-        
-        std::atomic<int> processed_active_pixels{0};
-        std::mutex print_mutex;
-
-        // Parallelize pixel loops
-        #pragma omp parallel for schedule(dynamic)
-        for (int j = 0; j < height; ++j) {
-            int row_processed_count = 0;
-
-            for (int i = 0; i < width; ++i) {
-                int index = j * width + i;
-
-                if (config.use_adaptive_sampling && pixel_converged[index]) {
-                    continue;
-                }
-                row_processed_count++;
-
-                glm::vec3 batch_color(0.0f);
-                glm::vec3 batch_color_sq(0.0f);
-
-                // Run the samples for this batch
-                for (int s = 0; s < current_batch_size; ++s) {
-                    float u = (float(i) + random_float()) / width;
-                    float v = (float(height - 1 - j) + random_float()) / height;
-
-                    Ray r = cam.get_ray(u, v);
-                    glm::vec3 rad = integrator->estimate_radiance(r, world);
-                    
-                    if (glm::any(glm::isnan(rad)) || glm::any(glm::isinf(rad))) rad = glm::vec3(0.0f);
-
-                    batch_color += rad;
-                    batch_color_sq += rad * rad;
-                }
-
-                // Update Buffers (Thread-safe due to distinct i, j ownership)
-                accumulation_buffer[index] += batch_color;
-                accumulation_buffer_sq[index] += batch_color_sq;
-                pixel_samples[index] += current_batch_size;
-
-                // --- Adaptive Sampling Convergence Check ---
-                if (config.use_adaptive_sampling && pixel_samples[index] >= config.min_samples) {
-                    float N = float(pixel_samples[index]);
-                    
-                    glm::vec3 mean = accumulation_buffer[index] / N;
-                    glm::vec3 mean_sq = accumulation_buffer_sq[index] / N;
-
-                    // Var(X) = E[X^2] - (E[X])^2
-                    float lum_mean = get_luminance(mean);
-                    float lum_mean_sq = get_luminance(mean_sq);
-                    float variance = std::abs(lum_mean_sq - lum_mean * lum_mean);
-
-                    // Standard Error (Standard Deviation of the Mean)
-                    // Error = sqrt(Variance / N)
-                    float error = std::sqrt(variance / N);
-
-                    if (error < config.adaptive_threshold) {
-                        pixel_converged[index] = true;
-                        total_active_pixels--;
-                    }
-                }
-            }
-            
-            if (row_processed_count > 0) {
-                int current_processed = (processed_active_pixels += row_processed_count);
-                if (omp_get_thread_num() == 0) {
-                     draw_progress_bar(current_processed, start_active_count, samples_loop_count + current_batch_size, total_active_pixels.load());
-                }
+        std::vector<ViewFilm*> film_ptrs;
+        for (size_t k = 0; k < views.size(); ++k) {
+            ViewJob view = views[k];
+            if (!tag.empty()) view.name = view.name.empty() ? tag : tag + "_" + view.name;
+            if (k < films.size()) films[k]->reset(view, config.samples_per_batch);
+            else films.push_back(std::make_unique<ViewFilm>(view, width, height, config.samples_per_batch));
+            if (config.region.enabled()) {
+                // Re-render a region on top of the saved film (or on an empty one)
+                films[k]->load(film_filename(SCENE_ID, method_tag, view.name));
+                films[k]->restrict_to(config.region);
             }
+            film_ptrs.push_back(films[k].get());
         }
-        draw_progress_bar(start_active_count, start_active_count, samples_loop_count + current_batch_size, total_active_pixels.load());
-        std::cout << std::flush;
 
-        samples_loop_count += current_batch_size;
-
-        bool is_milestone = false;
-        if (samples_loop_count >= next_save_milestone) {
-            is_milestone = true;
-            next_save_milestone *= 2;
+        if (config.concurrent_views) {
+            render_views(film_ptrs, config, world, *integrator, method_tag, pass_deadline);
+        } else {
+            for (size_t k = 0; k < film_ptrs.size(); ++k) {
+                render_views({film_ptrs[k]}, config, world, *integrator, method_tag,
+                             share_until(pass_deadline, int(film_ptrs.size() - k)));
+            }
         }
+    };
+    const size_t view_count = config.views.empty() ? (STEREO_EYE_DISTANCE > 0.0f ? 2 : 1) : config.views.size();
+    if (view_count > 1) {
+        std::cout << "Views: " << view_count << (config.concurrent_views ? " (concurrent)" : " (sequential)") << std::endl;
+    }
 
-        save_snapshot(samples_loop_count, width, height, accumulation_buffer, pixel_samples, method_tag, is_milestone);
-        std::cout << std::flush;
+    // --- FRAMES (static geometry, the packed shapes and, if nothing moves, the photon maps are reused) ---
+    const int frames = std::max(1, config.frame_count);
+    for (int frame = 0; frame < frames; ++frame) {
+        std::string frame_tag;
+        if (config.frame_count > 0) {
+            std::cout << "\n[Animation] Frame " << frame + 1 << "/" << frames << std::endl;
+            if (frame > 0) {
+                animation.apply(frame, config.frame_count, world, cam);
+                integrator->update(world, world.commit_changes(0.0f, 1.0f)); // Camera-only frames change nothing
+            }
+            std::stringstream ss;
+            ss << "frame" << std::setw(4) << std::setfill('0') << frame;
+            frame_tag = ss.str();
+        }
+        render_pass(frame_tag);
     }
 
-    save_snapshot(samples_loop_count, width, height, accumulation_buffer, pixel_samples, method_tag, true);
+    // --- EDITS (each one only invalidates what it touched) ---
+    for (size_t k = 0; config.render_edits && k < edits.size(); ++k) {
+        std::cout << "\n[Edit] " << k + 1 << "/" << edits.size() << std::endl;
+        edits[k](world, cam);
+        integrator->update(world, world.commit_changes(0.0f, 1.0f));
+
+        std::stringstream ss;
+        ss << "edit" << std::setw(2) << std::setfill('0') << k + 1;
+        render_pass(ss.str());
+    }
 
     std::cout << "\n\nRendering Complete!" << std::endl;
     return 0;
@@ -2,18 +2,18 @@
 
 #include "material_utils.hpp"
 #include "../core/onb.hpp"
-#include "../texture/solid_color.hpp"
+#include "../texture/texture_dispatch.hpp"
 /**
  * @brief Lambertian (Diffuse) material.
  * Scatters rays randomly using a cosine-weighted distribution (approximated here).
  */
-class Lambertian : public Material {
+class Lambertian final : public Material {
 public:
 
     /**
      * @brief Construct using a texture.
      */
-    Lambertian(std::shared_ptr<Texture> a, std::shared_ptr<Texture> n_map = nullptr) : albedo(a), normal_map(n_map) {}
+    Lambertian(std::shared_ptr<Texture> a, std::shared_ptr<Texture> n_map = nullptr) : Material(MaterialKind::Lambertian), albedo(a), normal_map(n_map) {}
     
     /**
      * @brief Construct using a solid color.
@@ -22,40 +22,14 @@ public:
 
     virtual bool scatter(const Ray& r_in, const HitRecord& rec, ScatterRecord& srec) const override {
         srec.is_specular = false; // a diffuse event
-        srec.attenuation = albedo->value(rec.u, rec.v, rec.p);
+        srec.bsdf = make_bsdf(rec);
+        srec.attenuation = srec.bsdf.albedo;
+        srec.shading_normal = srec.bsdf.frame.w();
 
-        glm::vec3 shading_normal = rec.normal;
-        if (normal_map) {
-            glm::vec3 map_val = normal_map->value(rec.u, rec.v, rec.p);
-            // Convert [0, 1] color to [-1, 1] vector
-            glm::vec3 local_n = 2.0f * map_val - glm::vec3(1.0f);
-            
-            // Create TBN basis from Geometry
-            Onb tbn(rec.normal, rec.tangent);
-            
-            // Transform from Tangent Space to World Space
-            shading_normal = glm::normalize(tbn.local(local_n));
-            srec.shading_normal = shading_normal; 
-        }
-
-        // 1. Build Orthonormal Basis from surface normal
-        Onb uvw(shading_normal);
-
-        // 2. Sample a direction in Tangent Space (Cosine Weighted)
-        // This vector is guaranteed to point outwards relative to the normal.
-        glm::vec3 direction_local = random_cosine_direction();
-
-        // 3. Transform to World Space
-        glm::vec3 scatter_direction = uvw.local(direction_local);
-        
-        // 4. Create the ray
-        srec.specular_ray = Ray(rec.p, glm::normalize(scatter_direction), r_in.time(), r_in.get_wavelength());
-
-        // 5. Calculate PDF
-        // For cosine-weighted sampling, p(direction) = cos(theta) / PI.
-        // Note: The integrator uses this PDF to divide the result.
-        // We use the same formula here so they cancel out nicely in the integrator logic.
-        srec.pdf = glm::dot(shading_normal, glm::normalize(scatter_direction)) * INV_PI;
+        // Cosine weighted direction around the shading normal, p(direction) = cos(theta) / PI.
+        // The integrator divides by this PDF, so it cancels the cosine of f_r * cos_theta.
+        glm::vec3 scatter_direction = srec.bsdf.sample(srec.pdf);
+        srec.specular_ray = Ray(rec.p, scatter_direction, r_in.time(), r_in.get_wavelength());
 
         return true;
     }
@@ -63,6 +37,7 @@ public:
     /**
      * @brief Evaluates the Lambertian BRDF.
      * Formula: f_r = albedo / PI
+     * Integrators use the closure from scatter() instead, which does not repeat the texture lookup.
      */
      virtual glm::vec3 eval(
         const Ray& r_in, const HitRecord& rec, const Ray& scattered, const glm::vec3& shading_normal
@@ -71,7 +46,7 @@ public:
         if (cos_theta <= 0) 
             return glm::vec3(0.0f);
 
-        return albedo->value(rec.u, rec.v, rec.p) * INV_PI;
+        return texture_value(*albedo, rec.u, rec.v, rec.p, rec.uv_width) * INV_PI;
     }
     
     // Future-proofing: Lambertian PDF is cos(theta) / PI
@@ -84,7 +59,39 @@ public:
     
     virtual bool is_specular() const override { return false; }
 
+    virtual void for_each_texture(const std::function<void(const Texture&)>& fn) const override {
+        if (albedo) fn(*albedo);
+        if (normal_map) fn(*normal_map);
+    }
+
 public:
     std::shared_ptr<Texture> albedo;
     std::shared_ptr<Texture> normal_map;
+
+private:
+    /**
+     * @brief Resolve albedo and shading frame (normal map applied) once for this hit.
+     */
+    BsdfClosure make_bsdf(const HitRecord& rec) const {
+        BsdfClosure bsdf;
+        bsdf.lobe = BsdfClosure::Lobe::Diffuse;
+        bsdf.albedo = texture_value(*albedo, rec.u, rec.v, rec.p, rec.uv_width);
+
+        glm::vec3 shading_normal = rec.normal;
+        if (normal_map) {
+            glm::vec3 map_val = texture_value(*normal_map, rec.u, rec.v, rec.p, rec.uv_width);
+            // Convert [0, 1] color to [-1, 1] vector
+            glm::vec3 local_n = 2.0f * map_val - glm::vec3(1.0f);
+            
+            // Create TBN basis from Geometry
+            Onb tbn(rec.normal, rec.tangent);
+            
+            // Transform from Tangent Space to World Space
+            shading_normal = glm::normalize(tbn.local(local_n));
+        }
+
+        // Orthonormal Basis around the shading normal
+        bsdf.frame = Onb(shading_normal);
+        return bsdf;
+    }
 };
\ No newline at end of file
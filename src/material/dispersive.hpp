@@ -7,7 +7,7 @@
  * Uses Stochastic Spectral Sampling: incoming white rays are randomly assigned 
  * a wavelength, and their IOR is calculated using Cauchy's Equation.
  */
-class DispersiveGlass : public Material {
+class DispersiveGlass final : public Material {
 public:
     /**
      * @brief Construct a new Dispersive Glass.
@@ -18,7 +18,7 @@ public:
      *                 For Borosilicate glass (BK7), A ~ 1.5046, B ~ 0.0042 (with lambda in micrometers).
      */
     DispersiveGlass(const glm::vec3& a, float cauchy_a, float cauchy_b) 
-        : albedo(a), A(cauchy_a), B(cauchy_b) {}
+        : Material(MaterialKind::DispersiveGlass), albedo(a), A(cauchy_a), B(cauchy_b) {}
 
     virtual bool scatter(const Ray& r_in, const HitRecord& rec, ScatterRecord& srec) const override {
         srec.is_specular = true;
@@ -6,13 +6,13 @@
  * @brief Dielectric material (Glass, Water, Diamond).
  * Handles both Reflection (BRDF) and Refraction (BTDF).
  */
-class Dielectric : public Material {
+class Dielectric final : public Material {
 public:
     /**
      * @param a The albedo (color) of the glass.
      * @param index_of_refraction Refractive index (e.g., Glass = 1.5, Water = 1.33, Diamond = 2.4).
      */
-    Dielectric(const glm::vec3& a, float index_of_refraction) : albedo(a), ir(index_of_refraction) {}
+    Dielectric(const glm::vec3& a, float index_of_refraction) : Material(MaterialKind::Dielectric), albedo(a), ir(index_of_refraction) {}
 
     virtual bool scatter(const Ray& r_in, const HitRecord& rec, ScatterRecord& srec) const override {
         srec.is_specular = true;
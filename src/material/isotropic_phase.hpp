@@ -1,7 +1,7 @@
 #pragma once
 
 #include "material_utils.hpp"
-#include "../texture/solid_color.hpp"
+#include "../texture/texture_dispatch.hpp"
 #include "../core/onb.hpp"
 
 /**
@@ -9,31 +9,31 @@
  * Represents a volume medium where light scatters uniformly in all directions.
  * Used for fog, smoke, etc.
  */
-class Isotropic : public Material {
+class Isotropic final : public Material {
 public:
     /**
      * @brief Construct with a solid color (non-emissive).
      */
     Isotropic(glm::vec3 c)
-        : albedo(std::make_shared<SolidColor>(c)), emit(std::make_shared<SolidColor>(0.0f, 0.0f, 0.0f)), emissive(false) {}
+        : Material(MaterialKind::Isotropic), albedo(std::make_shared<SolidColor>(c)), emit(std::make_shared<SolidColor>(0.0f, 0.0f, 0.0f)), emissive(false) {}
 
     /**
      * @brief Construct with a texture (non-emissive).
      */
     Isotropic(std::shared_ptr<Texture> a)
-        : albedo(a), emit(std::make_shared<SolidColor>(0.0f, 0.0f, 0.0f)), emissive(false) {}
+        : Material(MaterialKind::Isotropic), albedo(a), emit(std::make_shared<SolidColor>(0.0f, 0.0f, 0.0f)), emissive(false) {}
 
     /**
      * @brief Construct with Albedo and Emission (Texture).
      */
     Isotropic(std::shared_ptr<Texture> a, std::shared_ptr<Texture> e) 
-        : albedo(a), emit(e), emissive(true) {}
+        : Material(MaterialKind::Isotropic), albedo(a), emit(e), emissive(true) {}
     
     /**
      * @brief Construct with Albedo and Emission (Color).
      */
     Isotropic(glm::vec3 a, glm::vec3 e) 
-        : albedo(std::make_shared<SolidColor>(a)), emit(std::make_shared<SolidColor>(e)), emissive(true) {}
+        : Material(MaterialKind::Isotropic), albedo(std::make_shared<SolidColor>(a)), emit(std::make_shared<SolidColor>(e)), emissive(true) {}
 
     /**
      * @brief Scatters light uniformly in a random direction.
@@ -44,16 +44,16 @@ public:
         const Ray& r_in, const HitRecord& rec, ScatterRecord& srec
     ) const override {
         srec.is_specular = false; // It's diffuse-like (actually volumetric)
-        srec.attenuation = albedo->value(rec.u, rec.v, rec.p);
+        srec.bsdf.lobe = BsdfClosure::Lobe::Isotropic;
+        srec.bsdf.albedo = texture_value(*albedo, rec.u, rec.v, rec.p);
+        srec.attenuation = srec.bsdf.albedo;
         
         // Scatter inside the volume: Pick a random point on unit sphere (Directional independent)
-        glm::vec3 scattered_dir = random_unit_vector();
+        // PDF for uniform sphere sampling is 1 / (4 * PI)
+        glm::vec3 scattered_dir = srec.bsdf.sample(srec.pdf);
         
         srec.specular_ray = Ray(rec.p, scattered_dir, r_in.time(), r_in.get_wavelength());
         
-        // PDF for uniform sphere sampling is 1 / (4 * PI)
-        srec.pdf = 1.0f / (4.0f * PI); 
-        
         return true;
     }
 
@@ -64,7 +64,7 @@ public:
     virtual float scattering_pdf(
         const Ray& r_in, const HitRecord& rec, const Ray& scattered, const glm::vec3& shading_normal
     ) const override {
-        return 1.0f / (4.0f * PI);
+        return INV_4PI;
     }
     
     // Volumetric scattering usually doesn't define an explicit eval like BRDF 
@@ -73,7 +73,7 @@ public:
     virtual glm::vec3 eval(
         const Ray& r_in, const HitRecord& rec, const Ray& scattered, const glm::vec3& shading_normal
     ) const override {
-         return albedo->value(rec.u, rec.v, rec.p) * (1.0f / (4.0f * PI));
+         return texture_value(*albedo, rec.u, rec.v, rec.p) * INV_4PI;
     }
 
     /**
@@ -83,7 +83,7 @@ public:
      * So we can return true here, but be aware standard NEE won't target the volume unless you implement Light::sample_li for ConstantMedium.
      */
     virtual glm::vec3 emitted(float u, float v, const glm::vec3& p) const override {
-        return emit->value(u, v, p);
+        return texture_value(*emit, u, v, p);
     }
     
     /**
@@ -97,6 +97,11 @@ public:
     // TODO: specular volumetric
     virtual bool is_specular() const override { return false; }
 
+    virtual void for_each_texture(const std::function<void(const Texture&)>& fn) const override {
+        if (albedo) fn(*albedo);
+        if (emit) fn(*emit);
+    }
+
 public:
     std::shared_ptr<Texture> albedo;
     std::shared_ptr<Texture> emit;
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "material_agg.hpp"
+
+/**
+ * @brief Call 'fn' with the material downcast to its concrete (final) class, selected by Material::kind.
+ * Member calls inside 'fn' are then resolved statically and can be inlined into the integrator loop;
+ * materials outside the closed set are passed as the base class and use the vtable.
+ *
+ * @param fn Generic callable, e.g. [&](const auto& m) { return m.scatter(r, rec, srec); }.
+ */
+template <typename Fn>
+inline decltype(auto) visit_material(const Material& mat, Fn&& fn) {
+    switch (mat.kind) {
+    case MaterialKind::Lambertian:      return fn(static_cast<const Lambertian&>(mat));
+    case MaterialKind::Metal:           return fn(static_cast<const Metal&>(mat));
+    case MaterialKind::Dielectric:      return fn(static_cast<const Dielectric&>(mat));
+    case MaterialKind::DispersiveGlass: return fn(static_cast<const DispersiveGlass&>(mat));
+    case MaterialKind::DiffuseLight:    return fn(static_cast<const DiffuseLight&>(mat));
+    case MaterialKind::Isotropic:       return fn(static_cast<const Isotropic&>(mat));
+    default:                            return fn(mat);
+    }
+}
+
+inline bool material_scatter(const Material& mat, const Ray& r_in, const HitRecord& rec, ScatterRecord& srec) {
+    return visit_material(mat, [&](const auto& m) { return m.scatter(r_in, rec, srec); });
+}
+
+inline glm::vec3 material_emitted(const Material& mat, float u, float v, const glm::vec3& p) {
+    return visit_material(mat, [&](const auto& m) { return m.emitted(u, v, p); });
+}
+
+inline bool material_is_emissive(const Material& mat) {
+    return visit_material(mat, [](const auto& m) { return m.is_emissive(); });
+}
+
+inline bool material_is_transparent(const Material& mat) {
+    return visit_material(mat, [](const auto& m) { return m.is_transparent(); });
+}
+
+inline glm::vec3 material_transmission(const Material& mat, const HitRecord& rec) {
+    return visit_material(mat, [&](const auto& m) { return m.evaluate_transmission(rec); });
+}
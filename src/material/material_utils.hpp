@@ -4,8 +4,16 @@
 #include <glm/glm.hpp>
 #include "../core/utils.hpp"
 #include "../core/record.hpp"
+#include <cstdint>
+#include <functional>
 
+class Texture;
 
+/**
+ * @brief Tag of the concrete material class, used by visit_material() to dispatch without virtual calls.
+ * Materials defined outside the closed set keep 'Other' and go through the virtual interface.
+ */
+enum class MaterialKind : uint8_t { Other, Lambertian, Metal, Dielectric, DispersiveGlass, DiffuseLight, Isotropic };
 
 /**
  * @brief Abstract base class for materials.
@@ -13,6 +21,9 @@
  */
 class Material {
 public:
+    const MaterialKind kind;
+
+    explicit Material(MaterialKind kind = MaterialKind::Other) : kind(kind) {}
     virtual ~Material() = default;
 
     /**
@@ -99,4 +110,9 @@ public:
         // Although is_transparent() usually guards this call, returning 0 is a safe default.
         return glm::vec3(0.0f);
     }
+
+    /**
+     * @brief Call 'fn' for every texture the material reads (used to find the materials a texture edit affects).
+     */
+    virtual void for_each_texture(const std::function<void(const Texture&)>& fn) const {}
 };
\ No newline at end of file
@@ -1,41 +1,92 @@
 #pragma once
 
 #include "material_utils.hpp"
-#include "../texture/solid_color.hpp"
+#include "../core/onb.hpp"
+#include "../texture/texture_dispatch.hpp"
+#include <cmath>
+
 /**
- * @brief Metal (Specular) material.
- * Reflects rays perfectly or with some fuzziness.
+ * @brief Metal (conductor) material with a GGX microfacet distribution.
+ * Rough metals are glossy, non-specular events: their closure is sampled with visible normals and
+ * evaluated for NEE / MIS. Below METAL_SPECULAR_ALPHA the surface is a perfect (delta) mirror.
  */
-class Metal : public Material {
+class Metal final : public Material {
 public:
     /**
-     * @param a The albedo (color) of the reflection.
-     * @param f Fuzziness factor [0, 1]. 0 is perfect mirror.
+     * @param a The albedo (reflectance at normal incidence) of the metal.
+     * @param roughness GGX roughness alpha in [0, 1]. 0 is a perfect mirror.
      */
-    Metal(const glm::vec3& a, float f) : albedo(std::make_shared<SolidColor>(a)), fuzz(f < 1 ? f : 1) {}
-    Metal(std::shared_ptr<Texture> a, float f) : albedo(a), fuzz(f < 1 ? f : 1) {}
+    Metal(const glm::vec3& a, float roughness) : Metal(std::make_shared<SolidColor>(a), roughness) {}
+    Metal(std::shared_ptr<Texture> a, float roughness)
+        : Material(MaterialKind::Metal), albedo(a), alpha(std::clamp(roughness, 0.0f, 1.0f)) {}
 
     virtual bool scatter(const Ray& r_in, const HitRecord& rec, ScatterRecord& srec) const override {
-        glm::vec3 reflected = glm::reflect(glm::normalize(r_in.direction()), rec.normal);
-        
-        // For simplicity, even if fuzz > 0, the distribution is continuous, we still view it as single-point distribution.
-        
-        srec.is_specular = true; 
-        srec.attenuation = albedo->value(rec.u, rec.v, rec.p);
-        glm::vec3 scattered_dir = reflected + fuzz * random_in_unit_sphere();
-        if (near_zero(scattered_dir))
-            scattered_dir = reflected;
+        srec.attenuation = texture_value(*albedo, rec.u, rec.v, rec.p, rec.uv_width);
+
+        if (is_specular()) {
+            glm::vec3 reflected = glm::reflect(glm::normalize(r_in.direction()), rec.normal);
+            srec.is_specular = true;
+            srec.specular_ray = Ray(rec.p, reflected, r_in.time(), r_in.get_wavelength());
+            srec.pdf = 0.0f; // PDF of mirror reflection is meaningless.
+            return true;
+        }
+
+        srec.is_specular = false; // Glossy: sampled and evaluated through the closure
+        srec.bsdf = make_bsdf(r_in, rec, srec.attenuation);
+        srec.shading_normal = rec.normal;
+        glm::vec3 scattered_dir = srec.bsdf.sample(srec.pdf);
         srec.specular_ray = Ray(rec.p, scattered_dir, r_in.time(), r_in.get_wavelength());
-        srec.pdf = 0.0f; // PDF of mirror reflection is meaningless.
 
-        return (glm::dot(srec.specular_ray.direction(), rec.normal) > 0);
+        // Visible normals can still reflect below the surface (masked by the shadowing term)
+        return srec.pdf > 0.0f;
+    }
+
+    /**
+     * @brief GGX BRDF. Integrators use the closure from scatter() instead.
+     */
+    virtual glm::vec3 eval(
+        const Ray& r_in, const HitRecord& rec, const Ray& scattered, const glm::vec3& shading_normal
+    ) const override {
+        if (is_specular()) return glm::vec3(0.0f);
+        glm::vec3 a = texture_value(*albedo, rec.u, rec.v, rec.p, rec.uv_width);
+        return make_bsdf(r_in, rec, a).eval(scattered.direction());
     }
-    
+
+    virtual float scattering_pdf(const Ray& r_in, const HitRecord& rec, const Ray& scattered, const glm::vec3& shading_normal) const override {
+        if (is_specular()) return 0.0f;
+        return make_bsdf(r_in, rec, glm::vec3(0.0f)).pdf(scattered.direction());
+    }
+
     virtual bool is_emissive() const override { return false; }
 
-    virtual bool is_specular() const override { return true; }
+    /**
+     * @brief Only smooth metals are delta mirrors (and caustic casters for the photon mapper).
+     */
+    virtual bool is_specular() const override { return alpha < METAL_SPECULAR_ALPHA; }
+
+    /**
+     * @brief GGX roughness matching a Phong / Blinn-Phong exponent (MTL 'Ns'), alpha = sqrt(2 / (Ns + 2)).
+     */
+    static float roughness_from_exponent(float ns) {
+        return std::sqrt(2.0f / (std::max(ns, 0.0f) + 2.0f));
+    }
+
+    virtual void for_each_texture(const std::function<void(const Texture&)>& fn) const override {
+        if (albedo) fn(*albedo);
+    }
 
 public:
     std::shared_ptr<Texture> albedo;
-    float fuzz;
-};
\ No newline at end of file
+    float alpha;
+
+private:
+    BsdfClosure make_bsdf(const Ray& r_in, const HitRecord& rec, const glm::vec3& f0) const {
+        BsdfClosure bsdf;
+        bsdf.lobe = BsdfClosure::Lobe::Glossy;
+        bsdf.albedo = f0;
+        bsdf.alpha = alpha;
+        bsdf.frame = Onb(rec.normal);
+        bsdf.wo = bsdf.frame.world_to_local(-glm::normalize(r_in.direction()));
+        return bsdf;
+    }
+};
@@ -106,6 +106,7 @@ public:
         rec.p = r.at(rec.t);
         rec.mat_ptr = mat_ptr.get();
         rec.object = this;
+        rec.uv_scale = 0.0f;
 
         glm::vec3 local_p = rec.p - center;
 
@@ -159,27 +160,39 @@ public:
         HitRecord rec;
         if (!this->intersect(Ray(o, v), 0.001f, Infinity, rec))
             return 0.0f;
-        
-        // Convert Area PDF to Solid Angle PDF
-        // p(omega) = p(area) * dist^2 / cos(theta)
-        // p(area) = 1 / TotalArea
-        
-        float dist_squared = rec.t * rec.t * glm::dot(v, v);
-        float cosine = std::abs(glm::dot(v, rec.normal)); // v is ray direction, normalized? intersect uses ray direction
-        
-        // Note: Object interface implies v is direction. If it's not normalized, we need to handle that.
-        // Assuming v is normalized direction from random_pointing_vector logic.
-        
+        return pdf_value(o, v, rec);
+    }
+
+    /**
+     * @brief Convert the uniform area PDF at the known hit point to a solid angle PDF.
+     * p(omega) = p(area) * dist^2 / cos(theta), with p(area) = 1 / TotalArea
+     */
+    virtual float pdf_value(const glm::vec3& o, const glm::vec3& v, const HitRecord& rec) const override {
+        return area_pdf(o, rec.p, rec.normal);
+    }
+
+    float area_pdf(const glm::vec3& o, const glm::vec3& p, const glm::vec3& n) const {
+        glm::vec3 d = p - o;
+        float dist_squared = glm::dot(d, d);
+        if (dist_squared < EPSILON) return 0.0f;
+
+        float cosine = std::abs(glm::dot(d, n)) / std::sqrt(dist_squared);
         if (cosine < 1e-4f) return 0.0f;
 
         return dist_squared / (cosine * area);
     }
 
     virtual glm::vec3 random_pointing_vector(const glm::vec3& o) const override {
+        float pdf;
+        return random_pointing_vector(o, pdf);
+    }
+
+    virtual glm::vec3 random_pointing_vector(const glm::vec3& o, float& pdf) const override {
         // Sample a point on the cone surface
         glm::vec3 rand_p, rand_n;
         float dummy_area;
         sample_surface(rand_p, rand_n, dummy_area);
+        pdf = area_pdf(o, rand_p, rand_n);
 
         // Return vector from origin to surface point
         return rand_p - o;
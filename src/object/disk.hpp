@@ -6,7 +6,7 @@
 /**
  * @brief A Disk object defined by a center, a normal, and a radius.
  */
-class Disk : public Object {
+class Disk final : public Object {
 public:
     Disk() {}
 
@@ -43,6 +43,18 @@ public:
         // Check if point is within the disk radius
         if (dist_squared > radius * radius) return false;
 
+        fill_record(r, t, rec);
+        return true;
+    }
+
+    /**
+     * @brief Fill the hit record for a known plane distance 't' (shared with the batched kernels of PrimitiveSet).
+     */
+    void fill_record(const Ray& r, float t, HitRecord& rec) const {
+        glm::vec3 p = r.at(t);
+        glm::vec3 v = p - center;
+        float dist_squared = glm::dot(v, v);
+
         rec.t = t;
         rec.p = p;
         
@@ -62,14 +74,13 @@ public:
         float phi = atan2(y, x);
         if (phi < 0) phi += 2 * PI;
         rec.v = phi / (2 * PI);
+        rec.uv_scale = 1.0f / radius; // Radial scale; the angular one varies with r
 
         // Tangent for normal mapping (local X axis)
         rec.tangent = uvw.u();
 
         rec.mat_ptr = mat_ptr.get();
         rec.object = this;
-
-        return true;
     }
 
     /**
@@ -104,13 +115,25 @@ public:
         HitRecord rec;
         if (!this->intersect(Ray(o, v), 0.001f, Infinity, rec))
             return 0.0f;
+        return pdf_value(o, v, rec);
+    }
 
-        float area = PI * radius * radius;
-        float distance_squared = rec.t * rec.t * glm::dot(v, v);
-        float cosine = std::abs(glm::dot(v, rec.normal) / glm::length(v));
-        
+    virtual float pdf_value(const glm::vec3& o, const glm::vec3& v, const HitRecord& rec) const override {
+        return area_pdf(o, rec.p);
+    }
+
+    /**
+     * @brief Solid angle PDF of reaching point 'p' on the disk by uniform area sampling.
+     */
+    float area_pdf(const glm::vec3& o, const glm::vec3& p) const {
+        glm::vec3 d = p - o;
+        float distance_squared = glm::dot(d, d);
+        if (distance_squared < EPSILON) return 0.0f;
+
+        float cosine = std::abs(glm::dot(d, normal)) / std::sqrt(distance_squared);
         if (cosine < EPSILON) return 0.0f;
 
+        float area = PI * radius * radius;
         return distance_squared / (cosine * area);
     }
 
@@ -118,21 +141,15 @@ public:
      * @brief Randomly points to a spot on the disk from origin.
      */
     virtual glm::vec3 random_pointing_vector(const glm::vec3& o) const override {
-        // 1. Sample a point uniformly on a unit disk on XY plane
-        float r1 = random_float(); // For angle
-        float r2 = random_float(); // For radius
-        
-        float r = radius * sqrt(r2); // Sqrt for uniform area sampling
-        float phi = 2 * PI * r1;
-        
-        float x = r * cos(phi);
-        float y = r * sin(phi);
-
-        // 2. Transform to world space using ONB aligned with disk normal
-        Onb uvw(normal);
-        glm::vec3 random_point_on_disk = center + uvw.local(x, y, 0.0f);
+        float pdf;
+        return random_pointing_vector(o, pdf);
+    }
 
-        // 3. Return vector from origin to that point
+    virtual glm::vec3 random_pointing_vector(const glm::vec3& o, float& pdf) const override {
+        glm::vec3 random_point_on_disk, sample_normal;
+        float area;
+        sample_surface(random_point_on_disk, sample_normal, area);
+        pdf = area_pdf(o, random_point_on_disk);
         return random_point_on_disk - o;
     }
 
@@ -0,0 +1,353 @@
+#pragma once
+
+#include "object_utils.hpp"
+#include "../core/mapped_file.hpp"
+#include "../core/medium.hpp"
+#include "../material/isotropic_phase.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Heterogeneous medium: a voxel density grid inside an axis-aligned box.
+ *
+ * Storage is sparse: the grid is split into bricks of GRID_MEDIUM_BRICK_SIZE^3 voxels and only
+ * bricks holding non-zero density are kept. Each brick also stores a majorant (the largest density
+ * its trilinear lookups can return), forming a coarse super-grid. Free flights are sampled by delta
+ * tracking and transmittance is estimated by ratio tracking, both marching the super-grid with a
+ * 3D-DDA: empty bricks are skipped in one step, and dense bricks use their own tight majorant, so
+ * large, mostly empty volumes stay cheap.
+ *
+ * Like ConstantMedium, the box is a material-less boundary and the grid is the medium inside it.
+ *
+ * File format (.dgrid, little endian):
+ *   char[8] "DGRID001", uint32 nx, ny, nz, uint32 reserved (0),
+ *   float bounds_min[3], float bounds_max[3], then nx*ny*nz float densities (x fastest, then y, z).
+ */
+class GridMedium : public Object, public Medium {
+public:
+    /**
+     * @brief Load the density grid from a .dgrid file.
+     * @param density_scale Extinction per world unit at density 1.
+     * @param color Single scattering albedo of the medium.
+     */
+    GridMedium(const std::string& filename, float density_scale, glm::vec3 color)
+        : scale(density_scale), phase_function(std::make_shared<Isotropic>(color)) {
+        boundary_interface.inside = this;
+        load(filename);
+    }
+
+    /**
+     * @brief Build from a dense array of nx*ny*nz densities (x fastest) spanning 'box'.
+     */
+    GridMedium(const AABB& box, int nx, int ny, int nz, const std::vector<float>& densities,
+               float density_scale, std::shared_ptr<Texture> a)
+        : scale(density_scale), phase_function(std::make_shared<Isotropic>(a)) {
+        boundary_interface.inside = this;
+        build(box, nx, ny, nz, densities.data());
+    }
+
+    GridMedium(const AABB& box, int nx, int ny, int nz, const std::vector<float>& densities,
+               float density_scale, glm::vec3 color)
+        : GridMedium(box, nx, ny, nz, densities, density_scale, std::make_shared<SolidColor>(color)) {}
+
+    /**
+     * @brief Hit on the box only: no material, the ray crosses into get_medium_interface().
+     */
+    virtual bool intersect(const Ray& r, float t_min, float t_max, HitRecord& rec) const override {
+        float t_enter, t_exit;
+        int enter_axis, exit_axis;
+        if (!clip(r, t_enter, t_exit, &enter_axis, &exit_axis)) return false;
+
+        const bool entering = t_enter > t_min;
+        const float t = entering ? t_enter : t_exit;
+        if (t <= t_min || t >= t_max) return false;
+
+        const int axis = entering ? enter_axis : exit_axis;
+        glm::vec3 outward(0.0f);
+        outward[axis] = (r.direction()[axis] < 0.0f) == entering ? 1.0f : -1.0f;
+
+        rec.t = t;
+        rec.p = r.at(t);
+        rec.set_face_normal(r, outward);
+        rec.u = rec.v = 0.0f;
+        rec.uv_scale = 0.0f;
+        rec.prim_id = -1;
+        rec.mat_ptr = nullptr;
+        rec.object = this;
+        return true;
+    }
+
+    virtual const MediumInterface* get_medium_interface() const override { return &boundary_interface; }
+
+    /**
+     * @brief Delta tracking: tentative collisions against the brick majorant, accepted with
+     * probability density / majorant. Analog, so the weight is always 1.
+     */
+    virtual bool sample(const Ray& r, float t_max, HitRecord& rec, glm::vec3& weight) const override {
+        weight = glm::vec3(1.0f);
+        float t_event = Infinity;
+        march(r, t_max, [&](float t, float t_end, float majorant, float inv_step) {
+            while (true) {
+                t -= std::log(1.0f - random_float()) * inv_step;
+                if (t >= t_end) return true;
+                const float d = density(r.at(t));
+                assert(d <= majorant * 1.001f && "GridMedium: density above the cell majorant");
+                if (random_float() * majorant < d) {
+                    t_event = t;
+                    return false;
+                }
+            }
+        });
+        if (t_event == Infinity) return false;
+
+        rec.t = t_event;
+        rec.p = r.at(t_event);
+        rec.normal = glm::vec3(1, 0, 0); // Isotropic phase function: the normal is ignored
+        rec.front_face = true;
+        rec.u = rec.v = 0.0f;
+        rec.uv_scale = 0.0f;
+        rec.prim_id = -1;
+        rec.mat_ptr = phase_function.get();
+        rec.object = this;
+        return true;
+    }
+
+    /**
+     * @brief Ratio tracking: product of (1 - density / majorant) over tentative collisions,
+     * with Russian roulette once the estimate falls below GRID_MEDIUM_RR_THRESHOLD.
+     */
+    virtual glm::vec3 transmittance(const Ray& r, float t_max) const override {
+        float tr = 1.0f;
+        march(r, t_max, [&](float t, float t_end, float majorant, float inv_step) {
+            while (true) {
+                t -= std::log(1.0f - random_float()) * inv_step;
+                if (t >= t_end) return true;
+                const float d = density(r.at(t));
+                assert(d <= majorant * 1.001f && "GridMedium: density above the cell majorant");
+                tr *= 1.0f - d / majorant;
+                if (tr < GRID_MEDIUM_RR_THRESHOLD) {
+                    if (random_float() < 0.5f) { tr = 0.0f; return false; }
+                    tr *= 2.0f;
+                }
+            }
+        });
+        return glm::vec3(tr);
+    }
+
+    virtual bool bounding_box(float time0, float time1, AABB& output_box) const override {
+        output_box = bounds;
+        return true;
+    }
+
+    // Not a light source
+    virtual float pdf_value(const glm::vec3& origin, const glm::vec3& v) const override { return 0.0f; }
+    virtual glm::vec3 random_pointing_vector(const glm::vec3& origin) const override { return glm::vec3(1, 0, 0); }
+    virtual glm::vec3 random_pointing_vector(const glm::vec3& origin, float& pdf) const override {
+        pdf = 0.0f;
+        return glm::vec3(1, 0, 0);
+    }
+    virtual void sample_surface(glm::vec3& pos, glm::vec3& normal, float& area) const override {
+        pos = bounds.min_point();
+        normal = glm::vec3(1, 0, 0);
+        area = 0.0f;
+    }
+
+    virtual Material* get_material() const override { return phase_function.get(); }
+    virtual Material* get_phase_function() const override { return phase_function.get(); }
+
+    /**
+     * @brief Extinction coefficient (per world unit) at world position p, trilinearly interpolated.
+     */
+    float density(const glm::vec3& p) const {
+        const glm::vec3 v = (p - bounds.min_point()) * world_to_voxel - 0.5f;
+        const glm::vec3 f = glm::floor(v);
+        const glm::vec3 w = v - f;
+        const int x = int(f.x), y = int(f.y), z = int(f.z);
+
+        const float c00 = glm::mix(voxel(x, y, z),         voxel(x + 1, y, z),         w.x);
+        const float c10 = glm::mix(voxel(x, y + 1, z),     voxel(x + 1, y + 1, z),     w.x);
+        const float c01 = glm::mix(voxel(x, y, z + 1),     voxel(x + 1, y, z + 1),     w.x);
+        const float c11 = glm::mix(voxel(x, y + 1, z + 1), voxel(x + 1, y + 1, z + 1), w.x);
+        return scale * glm::mix(glm::mix(c00, c10, w.y), glm::mix(c01, c11, w.y), w.z);
+    }
+
+    bool empty() const { return bricks.empty(); }
+
+public:
+    AABB bounds;
+    float scale;
+    std::shared_ptr<Material> phase_function;
+
+private:
+    static constexpr int B = GRID_MEDIUM_BRICK_SIZE;
+
+    int res[3] = {0, 0, 0};          // Voxels per axis
+    int brick_res[3] = {0, 0, 0};    // Bricks per axis (super-grid resolution)
+    glm::vec3 world_to_voxel = glm::vec3(0.0f);
+    std::vector<int32_t> brick_index; // Super-grid cell -> brick slot, -1 if empty
+    std::vector<float> bricks;        // B^3 densities per stored brick
+    std::vector<float> majorants;     // Super-grid cell -> majorant (extinction per world unit)
+    MediumInterface boundary_interface;
+
+    float voxel(int x, int y, int z) const {
+        if (x < 0 || y < 0 || z < 0 || x >= res[0] || y >= res[1] || z >= res[2]) return 0.0f;
+        const int slot = brick_index[((z / B) * brick_res[1] + y / B) * brick_res[0] + x / B];
+        if (slot < 0) return 0.0f;
+        return bricks[size_t(slot) * B * B * B + ((z % B) * B + y % B) * B + x % B];
+    }
+
+    /**
+     * @brief Ray parameter range inside the box (t_enter may be negative when starting inside).
+     */
+    bool clip(const Ray& r, float& t_enter, float& t_exit, int* enter_axis = nullptr, int* exit_axis = nullptr) const {
+        const glm::vec3 t0 = (bounds.min_point() - r.origin()) * r.inv_direction();
+        const glm::vec3 t1 = (bounds.max_point() - r.origin()) * r.inv_direction();
+        const glm::vec3 t_small = glm::min(t0, t1);
+        const glm::vec3 t_big = glm::max(t0, t1);
+
+        int ea = t_small.x > t_small.y ? 0 : 1;
+        if (t_small.z > t_small[ea]) ea = 2;
+        int xa = t_big.x < t_big.y ? 0 : 1;
+        if (t_big.z < t_big[xa]) xa = 2;
+
+        t_enter = t_small[ea];
+        t_exit = t_big[xa];
+        if (enter_axis) *enter_axis = ea;
+        if (exit_axis) *exit_axis = xa;
+        return t_enter < t_exit && t_exit > 0.0f;
+    }
+
+    /**
+     * @brief 3D-DDA over the majorant super-grid along r within [0, t_max].
+     * Calls fn(t_begin, t_end, majorant, 1 / (majorant * |d|)) for every non-empty cell in order,
+     * until fn returns false. Restarting the exponential sampling per cell is exact (memoryless).
+     * Cells are exactly the bricks (B voxels wide), so when a resolution is not a multiple of B the
+     * last cell is partial: it is cut at the box, where the ray leaves the medium.
+     */
+    template <typename Fn>
+    void march(const Ray& r, float t_max, Fn&& fn) const {
+        if (bricks.empty()) return;
+        float t_enter, t_exit;
+        if (!clip(r, t_enter, t_exit)) return;
+        float t = std::max(t_enter, 0.0f);
+        t_exit = std::min(t_exit, t_max);
+        if (t >= t_exit) return;
+
+        const float dir_length = glm::length(r.direction());
+        const glm::vec3 cell_size = float(B) / world_to_voxel; // World size of a brick
+        const glm::vec3 start = (r.at(t) - bounds.min_point()) / cell_size;
+
+        int cell[3], step[3];
+        float t_next[3], t_delta[3];
+        for (int a = 0; a < 3; ++a) {
+            cell[a] = std::clamp(int(start[a]), 0, brick_res[a] - 1);
+            const float d = r.direction()[a];
+            if (d > 0.0f) {
+                step[a] = 1;
+                t_next[a] = (bounds.min_point()[a] + (cell[a] + 1) * cell_size[a] - r.origin()[a]) / d;
+                t_delta[a] = cell_size[a] / d;
+            } else if (d < 0.0f) {
+                step[a] = -1;
+                t_next[a] = (bounds.min_point()[a] + cell[a] * cell_size[a] - r.origin()[a]) / d;
+                t_delta[a] = -cell_size[a] / d;
+            } else {
+                step[a] = 0;
+                t_next[a] = Infinity;
+                t_delta[a] = Infinity;
+            }
+        }
+
+        while (t < t_exit) {
+            int a = t_next[0] < t_next[1] ? 0 : 1;
+            if (t_next[2] < t_next[a]) a = 2;
+            const float t_end = std::min(t_next[a], t_exit);
+
+            const float majorant = majorants[(cell[2] * brick_res[1] + cell[1]) * brick_res[0] + cell[0]];
+            if (majorant > 0.0f && t_end > t) {
+                if (!fn(t, t_end, majorant, 1.0f / (majorant * dir_length))) return;
+            }
+
+            t = t_end;
+            cell[a] += step[a];
+            if (cell[a] < 0 || cell[a] >= brick_res[a]) return;
+            t_next[a] += t_delta[a];
+        }
+    }
+
+    void load(const std::string& filename) {
+        MappedFile file(filename);
+        const size_t header_size = 8 + 4 * sizeof(uint32_t) + 6 * sizeof(float);
+        if (!file.is_open() || file.size() < header_size || std::memcmp(file.data(), "DGRID001", 8) != 0) {
+            std::cerr << "ERROR: Could not open density grid '" << filename << "'.\n";
+            return;
+        }
+
+        uint32_t dims[4];
+        float box[6];
+        std::memcpy(dims, file.data() + 8, sizeof(dims));
+        std::memcpy(box, file.data() + 8 + sizeof(dims), sizeof(box));
+        const size_t count = size_t(dims[0]) * dims[1] * dims[2];
+        if (count == 0 || file.size() < header_size + count * sizeof(float)) {
+            std::cerr << "ERROR: Truncated density grid '" << filename << "'.\n";
+            return;
+        }
+
+        // The payload may be unaligned in the mapping: copy it out once
+        std::vector<float> densities(count);
+        std::memcpy(densities.data(), file.data() + header_size, count * sizeof(float));
+        build(AABB(glm::vec3(box[0], box[1], box[2]), glm::vec3(box[3], box[4], box[5])),
+              int(dims[0]), int(dims[1]), int(dims[2]), densities.data());
+        std::cout << "[GridMedium] Loaded " << dims[0] << "x" << dims[1] << "x" << dims[2] << " voxels ("
+                  << bricks.size() / (B * B * B) << " of " << majorants.size() << " bricks occupied) from "
+                  << filename << std::endl;
+    }
+
+    void build(const AABB& box, int nx, int ny, int nz, const float* dense) {
+        bounds = box;
+        res[0] = nx; res[1] = ny; res[2] = nz;
+        for (int a = 0; a < 3; ++a) brick_res[a] = (res[a] + B - 1) / B;
+        world_to_voxel = glm::vec3(nx, ny, nz) / (box.max_point() - box.min_point());
+
+        auto at = [&](int x, int y, int z) { return std::max(dense[(size_t(z) * ny + y) * nx + x], 0.0f); };
+
+        // Sparse bricks: keep only those holding density
+        const size_t cells = size_t(brick_res[0]) * brick_res[1] * brick_res[2];
+        brick_index.assign(cells, -1);
+        bricks.clear();
+        for (int bz = 0; bz < brick_res[2]; ++bz)
+        for (int by = 0; by < brick_res[1]; ++by)
+        for (int bx = 0; bx < brick_res[0]; ++bx) {
+            std::vector<float> brick(size_t(B) * B * B, 0.0f);
+            bool occupied = false;
+            for (int z = 0; z < B && bz * B + z < nz; ++z)
+            for (int y = 0; y < B && by * B + y < ny; ++y)
+            for (int x = 0; x < B && bx * B + x < nx; ++x) {
+                const float d = at(bx * B + x, by * B + y, bz * B + z);
+                brick[(z * B + y) * B + x] = d;
+                occupied |= d > 0.0f;
+            }
+            if (!occupied) continue;
+            brick_index[(size_t(bz) * brick_res[1] + by) * brick_res[0] + bx] = int32_t(bricks.size() / brick.size());
+            bricks.insert(bricks.end(), brick.begin(), brick.end());
+        }
+
+        // Majorants: trilinear lookups inside a brick read one voxel beyond it on each side
+        majorants.assign(cells, 0.0f);
+        for (int bz = 0; bz < brick_res[2]; ++bz)
+        for (int by = 0; by < brick_res[1]; ++by)
+        for (int bx = 0; bx < brick_res[0]; ++bx) {
+            float m = 0.0f;
+            for (int z = std::max(bz * B - 1, 0); z <= std::min(bz * B + B, nz - 1); ++z)
+            for (int y = std::max(by * B - 1, 0); y <= std::min(by * B + B, ny - 1); ++y)
+            for (int x = std::max(bx * B - 1, 0); x <= std::min(bx * B + B, nx - 1); ++x)
+                m = std::max(m, at(x, y, z));
+            majorants[(size_t(bz) * brick_res[1] + by) * brick_res[0] + bx] = m * scale;
+        }
+    }
+};
@@ -1,20 +1,21 @@
 #pragma once
 
-#include "triangle.hpp"
-#include "../accel/BVH.hpp"
-#include "tiny_obj_loader.h"
+#include "triangle_mesh.hpp"
+#include "../core/task_graph.hpp"
 #include <iostream>
 #include <vector>
 #include <string>
 #include <filesystem>
+#include <numeric>
 #include <glm/gtc/matrix_transform.hpp> 
 #include "../material/material_agg.hpp"
-#include "../texture/image_texture.hpp"
+#include "../texture/texture_registry.hpp"
 #include "../texture/solid_color.hpp"
 
 /**
  * @brief Represents a triangle mesh loaded from a file (e.g., .obj).
- * Manages its own internal BVH for efficient intersection within the mesh.
+ * Geometry is kept as a compact indexed TriangleMesh with its own flat BVH.
+ * It comes from load_mesh_data, so repeated runs read a binary cache instead of the OBJ.
  */
 class Mesh : public Object {
 public:
@@ -35,19 +36,40 @@ public:
          float rotate_degrees = 0.0f) 
     {
         mat_ptr = mat;
-        load_obj(filename, mat, translate, scale, rotate_axis, rotate_degrees);
+        // Parsing and the per-mesh BVH build run on the task graph, concurrently with other meshes
+        loading = TaskGraph::instance().submit([=] {
+            load_obj(filename, mat, translate, scale, rotate_axis, rotate_degrees);
+        });
     }
+
+    ~Mesh() { finish_loading(); }
+
+    virtual void finish_loading() override {
+        if (!loading) return;
+        TaskGraph::instance().wait(loading);
+        loading = nullptr;
+    }
+
+    /**
+     * @brief Pose the mesh for an animation frame: 'transform' applies on top of the constructor placement.
+     * Only the mesh's own BVH is refit; the owning Scene must rebuild its top level afterwards.
+     */
+    void set_transform(const glm::mat4& transform) {
+        finish_loading();
+        geometry.set_transform(transform);
+    }
+
     /**
-     * @brief Intersects the mesh by delegating to its internal BVH.
+     * @brief Intersects the mesh by traversing its internal BVH.
      */
     virtual bool intersect(const Ray& r, float t_min, float t_max, HitRecord& rec) const override {
-        if (!bvh_root) return false;
-        return bvh_root->intersect(r, t_min, t_max, rec);
+        return geometry.intersect(r, t_min, t_max, rec, this);
     }
 
     virtual bool bounding_box(float time0, float time1, AABB& output_box) const override {
-        if (!bvh_root) return false;
-        return bvh_root->bounding_box(time0, time1, output_box);
+        if (geometry.empty()) return false;
+        output_box = geometry.bounds();
+        return true;
     }
 
     /**
@@ -55,75 +77,66 @@ public:
      * Uses an area-weighted distribution to select a triangle, then samples the triangle.
      */
     virtual void sample_surface(glm::vec3& pos, glm::vec3& normal, float& area) const override {
-        if (!triangle_distribution) {
-            area = 0.0f;
-            return;
-        }
+        geometry.sample_surface(pos, normal, area);
+    }
 
-        // 1. Select a triangle based on area
-        float pdf_choice;
-        float u_remapped;
-        int idx = triangle_distribution->sample_discrete(random_float(), pdf_choice, u_remapped);
+    /**
+     * @brief Pick a triangle proportionally to its emitted power, then sample it by solid angle.
+     */
+    virtual glm::vec3 random_pointing_vector(const glm::vec3& origin) const override {
+        float pdf;
+        return random_pointing_vector(origin, pdf);
+    }
 
-        // 2. Sample the selected triangle
-        // Note: The object in 'triangles' is technically shared_ptr<Object>, cast to Triangle if needed
-        // but virtual function call works since Triangle implements it.
-        triangles[idx]->sample_surface(pos, normal, area);
-        area = sum_area;
+    virtual glm::vec3 random_pointing_vector(const glm::vec3& origin, float& pdf) const override {
+        return geometry.sample_direction(origin, pdf);
     }
 
-    virtual glm::vec3 random_pointing_vector(const glm::vec3& origin) const override{return glm::vec3(0.0f);}
-    virtual float pdf_value(const glm::vec3& origin, const glm::vec3& wi) const override {return 0.0f;}
-    
-    virtual Material* get_material() const override { return mat_ptr.get(); } // Material is managed by triangles
+    /**
+     * @brief Combined PDF: P(select triangle) * p(direction | triangle).
+     * The first triangle hit along 'wi' is the only one whose sample can be unoccluded in that direction.
+     */
+    virtual float pdf_value(const glm::vec3& origin, const glm::vec3& wi) const override {
+        HitRecord rec;
+        if (!intersect(Ray(origin, wi), 0.001f, Infinity, rec))
+            return 0.0f;
+
+        return pdf_value(origin, wi, rec);
+    }
 
     /**
-     * @brief Propagate light ID to all contained triangles.
-     * This ensures that when a ray hits a specific triangle, rec.object->get_light_id() returns the correct value.
+     * @brief 'rec.prim_id' is the triangle that was hit, so no traversal of the mesh BVH is needed.
      */
-    virtual void set_light_id(int id) override {
-        Object::set_light_id(id); // Set ID for the Mesh itself
-        for (auto& tri : triangles) tri->set_light_id(id);
+    virtual float pdf_value(const glm::vec3& origin, const glm::vec3& wi, const HitRecord& rec) const override {
+        return geometry.pdf(origin, rec.prim_id, rec.p);
+    }
+    
+    virtual Material* get_material() const override { return mat_ptr.get(); }
+
+    virtual void for_each_material(const std::function<void(const Material&)>& fn) const override {
+        for (const auto& mat : geometry.materials) if (mat) fn(*mat);
     }
 
 private:
-    std::shared_ptr<BVHNode> bvh_root;
+    TriangleMesh geometry;
     std::shared_ptr<Material> mat_ptr;
-    std::vector<std::shared_ptr<Object>> triangles;
-    std::unique_ptr<Distribution1D> triangle_distribution;
     std::vector<std::shared_ptr<Material>> obj_materials; // Added: Store materials loaded from OBJ/MTL
-    float sum_area = 0.0f;
+    TaskHandle loading; // Pending load_obj task, null once finished
 
     
     /**
-     * @brief Parses the OBJ file, loads materials (if not overridden), and builds geometry.
+     * @brief Loads the mesh data (OBJ or its cache), creates materials (if not overridden) and builds geometry.
      */
     void load_obj(const std::string& filename, std::shared_ptr<Material> global_mat,
                   glm::vec3 translation, float scale, glm::vec3 rot_axis, float rot_deg) 
     {
-        // 1. Setup TinyObjReader
-        tinyobj::ObjReaderConfig reader_config;
-        // Search for .mtl in the same directory as the .obj
+        // 1. Indexed, BVH ordered data in object space
+        MeshData data;
+        if (!load_mesh_data(filename, data)) return;
+
+        // Textures are referenced relative to the directory of the .obj
         auto last_slash = filename.find_last_of("/\\");
         std::string base_dir = (last_slash != std::string::npos) ? filename.substr(0, last_slash + 1) : "./";
-        reader_config.mtl_search_path = base_dir; 
-
-        tinyobj::ObjReader reader;
-
-        if (!reader.ParseFromFile(filename, reader_config)) {
-            if (!reader.Error().empty()) {
-                std::cerr << "TinyObjReader Error: " << reader.Error();
-            }
-            return;
-        }
-
-        if (!reader.Warning().empty()) {
-            std::cout << "TinyObjReader Warning: " << reader.Warning();
-        }
-
-        auto& attrib = reader.GetAttrib();
-        auto& shapes = reader.GetShapes();
-        auto& materials = reader.GetMaterials(); 
 
         // 2. Load Materials from MTL (Only if no global override is provided)
         // We use the default gray fallback if a face has no material assigned.
@@ -131,31 +144,21 @@ private:
 
         if (!global_mat) {
             std::cout << "[Mesh] Loading materials from MTL..." << std::endl;
-            for (const auto& m : materials) {
+            for (const auto& m : data.materials) {
                 // A. Diffuse / Albedo
                 std::shared_ptr<Texture> albedo_tex;
                 if (!m.diffuse_texname.empty()) {
                     std::string tex_path = base_dir + m.diffuse_texname;
-                    albedo_tex = std::make_shared<ImageTexture>(tex_path.c_str());
+                    albedo_tex = load_image_texture(tex_path);
                 } else {
                     albedo_tex = std::make_shared<SolidColor>(glm::vec3(m.diffuse[0], m.diffuse[1], m.diffuse[2]));
                 }
 
                 // B. Normal Map
-                // Blender typically exports normal maps to 'norm' or 'map_Kn'. 
-                // TinyObjLoader might parse generic bump maps into bump_texname.
                 std::shared_ptr<Texture> normal_tex = nullptr;
-                std::string normal_path = "";
-                
                 if (!m.normal_texname.empty()) {
-                    normal_path = m.normal_texname;
-                } else if (!m.bump_texname.empty()) {
-                    normal_path = m.bump_texname; // Fallback if encoded as bump
-                }
-
-                if (!normal_path.empty()) {
-                    std::string full_path = base_dir + normal_path;
-                    normal_tex = std::make_shared<ImageTexture>(full_path.c_str());
+                    std::string full_path = base_dir + m.normal_texname;
+                    normal_tex = load_image_texture(full_path);
                 }
 
                 // C. Construct Lambertian Material
@@ -188,10 +191,8 @@ private:
                     obj_materials.push_back(std::make_shared<Dielectric>(glass_color, ni));
                 } 
                 else if (is_metal) {
-                    float fuzz = 1.0f - (ns / 1000.0f);
-                    fuzz = std::max(0.0f, std::min(fuzz, 1.0f)); // Clamp to [0,1]
-                    
-                    obj_materials.push_back(std::make_shared<Metal>(albedo_tex, fuzz));
+                    // GGX roughness equivalent to the Phong exponent
+                    obj_materials.push_back(std::make_shared<Metal>(albedo_tex, Metal::roughness_from_exponent(ns)));
                 } 
                 else {
                     obj_materials.push_back(std::make_shared<Lambertian>(albedo_tex, normal_tex));
@@ -206,112 +207,19 @@ private:
         trans_mat = glm::rotate(trans_mat, rad, rot_axis);
         trans_mat = glm::scale(trans_mat, glm::vec3(scale));
 
-        // Helper: Transform Point
-        auto transform_point = [&](float x, float y, float z) {
-            glm::vec4 p(x, y, z, 1.0f);
-            p = trans_mat * p;
-            return glm::vec3(p);
-        };
-
-        // Helper: Transform Normal (Inverse Transpose)
+        // Transform vertices once (normals with the inverse transpose; zero normals stay zero)
         glm::mat3 normal_mat = glm::mat3(glm::transpose(glm::inverse(trans_mat)));
-        auto transform_normal = [&](float x, float y, float z) {
-            return glm::normalize(normal_mat * glm::vec3(x, y, z));
-        };
-
-        std::cout << "[Mesh] Processing geometry for " << filename << " (" << shapes.size() << " shapes)..." << std::endl;
-        std::vector<float> triangle_areas;
-
-        // 4. Iterate Shapes and Faces
-        for (size_t s = 0; s < shapes.size(); s++) {
-            size_t index_offset = 0;
-            
-            for (size_t f = 0; f < shapes[s].mesh.num_face_vertices.size(); f++) {
-                size_t fv = size_t(shapes[s].mesh.num_face_vertices[f]);
-                
-                // Only process triangles
-                if (fv != 3) {
-                    index_offset += fv;
-                    continue; 
-                }
-
-                // Determine Material
-                std::shared_ptr<Material> face_mat;
-                if (global_mat) {
-                    face_mat = global_mat;
-                } else {
-                    int mat_id = shapes[s].mesh.material_ids[f];
-                    if (mat_id >= 0 && mat_id < static_cast<int>(obj_materials.size())) {
-                        face_mat = obj_materials[mat_id];
-                    } else {
-                        face_mat = fallback_mat;
-                    }
-                }
-
-                glm::vec3 v[3];
-                glm::vec3 n[3];
-                glm::vec2 uv[3];
-                bool has_normals = true;
-
-                // Extract Vertex Data
-                for (size_t v_idx = 0; v_idx < 3; v_idx++) {
-                    tinyobj::index_t idx = shapes[s].mesh.indices[index_offset + v_idx];
-
-                    // Position
-                    v[v_idx] = transform_point(
-                        attrib.vertices[3 * size_t(idx.vertex_index) + 0],
-                        attrib.vertices[3 * size_t(idx.vertex_index) + 1],
-                        attrib.vertices[3 * size_t(idx.vertex_index) + 2]
-                    );
-
-                    // Normal
-                    if (idx.normal_index >= 0) {
-                        n[v_idx] = transform_normal(
-                            attrib.normals[3 * size_t(idx.normal_index) + 0],
-                            attrib.normals[3 * size_t(idx.normal_index) + 1],
-                            attrib.normals[3 * size_t(idx.normal_index) + 2]
-                        );
-                    } else {
-                        has_normals = false;
-                    }
-
-                    // UV
-                    if (idx.texcoord_index >= 0) {
-                        uv[v_idx] = glm::vec2(
-                            attrib.texcoords[2 * size_t(idx.texcoord_index) + 0],
-                            attrib.texcoords[2 * size_t(idx.texcoord_index) + 1]
-                        );
-                    } else {
-                        uv[v_idx] = glm::vec2(0.0f);
-                    }
-                }
-
-                // Create Triangle
-                if (has_normals) {
-                    auto tri = std::make_shared<Triangle>(
-                        v[0], v[1], v[2], n[0], n[1], n[2], face_mat, uv[0], uv[1], uv[2]
-                    );
-                    triangles.push_back(tri);
-                    triangle_areas.push_back(tri->area);
-                } else {
-                    auto tri = std::make_shared<Triangle>(
-                        v[0], v[1], v[2], face_mat, uv[0], uv[1], uv[2]
-                    );
-                    triangles.push_back(tri);
-                    triangle_areas.push_back(tri->area);
-                }
-
-                index_offset += fv;
-            }
+        for (size_t i = 0; i < data.positions.size(); ++i) {
+            data.positions[i] = glm::vec3(trans_mat * glm::vec4(data.positions[i], 1.0f));
+            if (data.normals[i] != glm::vec3(0.0f)) data.normals[i] = glm::normalize(normal_mat * data.normals[i]);
         }
 
-        // 5. Finalize Geometry
-        sum_area = std::accumulate(triangle_areas.begin(), triangle_areas.end(), 0.0f);
+        // 4. Hand the indexed data over (BVH order is kept, per-face materials become table slots)
+        geometry.build(data, obj_materials, global_mat, fallback_mat);
 
-        if (!triangles.empty()) {
-            std::cout << "[Mesh] Building BVH for " << triangles.size() << " triangles..." << std::endl;
-            bvh_root = std::make_shared<BVHNode>(triangles, 0.0f, 1.0f);
-            triangle_distribution = std::make_unique<Distribution1D>(triangle_areas.data(), triangle_areas.size());
-        }
+        size_t count = geometry.triangle_count();
+        std::cout << "[Mesh] " << filename << ": " << count << " triangles, "
+                  << (count ? geometry.memory_usage() / count : 0) << " bytes per triangle (+"
+                  << (count ? geometry.sampling_memory_usage() / count : 0) << " for sampling tables)" << std::endl;
     }
 };
\ No newline at end of file
@@ -1,8 +1,8 @@
 #pragma once
 
-#include "object_utils.hpp"
+#include "sphere.hpp"
 
-class MovingSphere : public Object {
+class MovingSphere final : public Object {
 public:
     MovingSphere() {}
     MovingSphere(glm::vec3 cen0, glm::vec3 cen1, float _time0, float _time1, float r, std::shared_ptr<Material> m)
@@ -11,33 +11,27 @@ public:
 
     virtual bool intersect(const Ray& r, float t_min, float t_max, HitRecord& rec) const override {
         glm::vec3 center = center_at(r.time());
-        glm::vec3 oc = r.origin() - center;
-        float a = glm::dot(r.direction(), r.direction());
-        float half_b = glm::dot(oc, r.direction());
-        float c = glm::dot(oc, oc) - radius * radius;
-
-        float discriminant = half_b * half_b - a * c;
-        if (discriminant < 0) return false;
-        float sqrtd = sqrt(discriminant);
-
-        float root = (-half_b - sqrtd) / a;
-        if (root < t_min || root > t_max) {
-            root = (-half_b + sqrtd) / a;
-            if (root < t_min || root > t_max)
-                return false;
-        }
+        float t;
+        if (!intersect_sphere(r.origin(), r.direction(), center, radius, t_min, t_max, t))
+            return false;
+        fill_record(r, t, center, rec);
+        return true;
+    }
 
-        rec.t = root;
+    /**
+     * @brief Fill the hit record for a known root 't', with the center already evaluated at the ray time.
+     */
+    void fill_record(const Ray& r, float t, const glm::vec3& center, HitRecord& rec) const {
+        rec.t = t;
         rec.p = r.at(rec.t);
         glm::vec3 outward_normal = (rec.p - center) / radius;
         rec.set_face_normal(r, outward_normal);
+        rec.uv_scale = 0.0f;
         rec.mat_ptr = mat_ptr.get();
         rec.object = this;
         
         // UV mapping usually similar to static sphere
         // get_sphere_uv(outward_normal, rec.u, rec.v); 
-
-        return true;
     }
 
     virtual void sample_surface(glm::vec3& pos, glm::vec3& normal, float& area) const override {
@@ -0,0 +1,416 @@
+#pragma once
+
+#include "../core/utils.hpp"
+#include "../core/mapped_file.hpp"
+#include "../accel/flat_bvh.hpp"
+#include "tiny_obj_loader.h"
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief The parts of an MTL material the mesh classes turn into Material objects.
+ */
+struct MeshMaterialDesc {
+    int32_t illum = 0;
+    float diffuse[3] = {0.0f, 0.0f, 0.0f};
+    float specular[3] = {0.0f, 0.0f, 0.0f};
+    float transmittance[3] = {0.0f, 0.0f, 0.0f};
+    float ior = 1.0f;
+    float shininess = 0.0f;
+    std::string diffuse_texname; // Relative to the OBJ directory, empty if none
+    std::string normal_texname;  // Normal map, or the bump map when no normal map is given
+};
+
+/**
+ * @brief Indexed triangle mesh in object space, as read from an OBJ file or its binary cache.
+ * Triangles are stored in the order of the BVH leaves.
+ */
+struct MeshData {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;     // Per vertex; zero when the OBJ face has no normal
+    std::vector<glm::vec2> uvs;         // Per vertex; zero when the OBJ face has no texcoord
+    std::vector<uint32_t> indices;      // 3 per triangle
+    std::vector<int32_t> material_ids;  // 1 per triangle, -1 for none
+    std::vector<MeshMaterialDesc> materials;
+    FlatBVH bvh;                        // Over the triangles, object space
+
+    size_t triangle_count() const { return material_ids.size(); }
+};
+
+namespace mesh_cache_detail {
+
+constexpr char MAGIC[8] = {'M', 'E', 'S', 'H', '0', '0', '0', '2'};
+
+struct Header {
+    char magic[8];
+    uint64_t key;
+    uint32_t vertex_count;
+    uint32_t triangle_count;
+    uint32_t material_count;
+    uint32_t node_count;
+};
+
+struct MaterialRecord {
+    int32_t illum;
+    float diffuse[3];
+    float specular[3];
+    float transmittance[3];
+    float ior;
+    float shininess;
+    uint32_t diffuse_texname_length;
+    uint32_t normal_texname_length;
+};
+
+/**
+ * @brief Bounds-checked sequential reads from a mapped file.
+ */
+struct Reader {
+    const unsigned char* cursor;
+    size_t remaining;
+
+    /**
+     * @brief Whether 'count' elements of T are left; checked before sizing a buffer from an untrusted count.
+     */
+    template <typename T>
+    bool fits(size_t count) const {
+        return count <= remaining / sizeof(T);
+    }
+
+    template <typename T, typename Alloc>
+    bool read(std::vector<T, Alloc>& out, size_t count) {
+        if (!fits<T>(count)) return false;
+        out.resize(count);
+        return read(out.data(), count);
+    }
+
+    template <typename T>
+    bool read(T* out, size_t count) {
+        size_t bytes = count * sizeof(T);
+        if (bytes > remaining) return false;
+        if (bytes > 0) std::memcpy(out, cursor, bytes);
+        cursor += bytes;
+        remaining -= bytes;
+        return true;
+    }
+
+    bool read(std::string& out, size_t length) {
+        if (length > remaining) return false;
+        out.assign(reinterpret_cast<const char*>(cursor), length);
+        cursor += length;
+        remaining -= length;
+        return true;
+    }
+};
+
+/**
+ * @brief Names listed on the "mtllib" lines of an OBJ file.
+ */
+inline std::vector<std::string> material_libraries(const MappedFile& obj) {
+    std::vector<std::string> names;
+    const char* text = reinterpret_cast<const char*>(obj.data());
+    size_t size = obj.size();
+    for (size_t line = 0; line < size;) {
+        size_t end = line;
+        while (end < size && text[end] != '\n') ++end;
+        if (end - line > 7 && std::strncmp(text + line, "mtllib", 6) == 0 && (text[line + 6] == ' ' || text[line + 6] == '\t')) {
+            size_t i = line + 7;
+            while (i < end) {
+                while (i < end && std::isspace(static_cast<unsigned char>(text[i]))) ++i;
+                size_t start = i;
+                while (i < end && !std::isspace(static_cast<unsigned char>(text[i]))) ++i;
+                if (i > start) names.emplace_back(text + start, i - start);
+            }
+        }
+        line = end + 1;
+    }
+    return names;
+}
+
+/**
+ * @brief Content hash of the OBJ and of every material library it references.
+ */
+inline uint64_t source_key(const MappedFile& obj, const std::string& base_dir) {
+    uint64_t key = fnv1a_64(MAGIC, sizeof(MAGIC));
+    key = fnv1a_64(obj.data(), obj.size(), key);
+    for (const std::string& name : material_libraries(obj)) {
+        MappedFile mtl(base_dir + name);
+        key = fnv1a_64(name.data(), name.size(), key);
+        if (mtl.is_open()) key = fnv1a_64(mtl.data(), mtl.size(), key);
+    }
+    return key;
+}
+
+/**
+ * @brief Check that every index read from a cache stays inside the arrays it refers to, so a
+ * corrupted file that kept its magic and key is rejected instead of read out of bounds.
+ * The BVH must be laid out as FlatBVH builds it: first child right after its parent, second child
+ * further on, and no deeper than the traversal stack.
+ */
+inline bool valid_cache_data(const MeshData& data) {
+    const size_t vertex_count = data.positions.size();
+    const size_t triangle_count = data.triangle_count();
+    const int32_t material_count = static_cast<int32_t>(data.materials.size());
+
+    for (uint32_t index : data.indices)
+        if (index >= vertex_count) return false;
+    for (int32_t id : data.material_ids)
+        if (id < -1 || id >= material_count) return false;
+
+    const auto& nodes = data.bvh.nodes;
+    if (nodes.empty()) return triangle_count == 0;
+    std::vector<int> depth(nodes.size(), 0);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const FlatBVHNode& node = nodes[i];
+        if (depth[i] >= FLAT_BVH_STACK_SIZE) return false;
+        if (node.count > 0) {
+            if (node.offset < 0 || size_t(node.offset) + node.count > triangle_count) return false;
+            continue;
+        }
+        if (node.axis > 2 || i + 1 >= nodes.size() || node.offset <= int64_t(i) + 1 || size_t(node.offset) >= nodes.size())
+            return false;
+        depth[i + 1] = depth[node.offset] = depth[i] + 1;
+    }
+    return true;
+}
+
+inline bool read_cache(const std::string& cache_path, uint64_t key, MeshData& data) {
+    MappedFile file(cache_path);
+    if (!file.is_open()) return false;
+
+    Reader in{file.data(), file.size()};
+    Header header;
+    if (!in.read(&header, 1) || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.key != key)
+        return false;
+
+    // Every array is sized only after the bytes behind it are known to exist
+    if (!in.read(data.positions, header.vertex_count)
+        || !in.read(data.normals, header.vertex_count)
+        || !in.read(data.uvs, header.vertex_count)
+        || !in.read(data.indices, size_t(header.triangle_count) * 3)
+        || !in.read(data.material_ids, header.triangle_count)
+        || !in.read(data.bvh.nodes, header.node_count)
+        || !in.fits<MaterialRecord>(header.material_count)) {
+        return false;
+    }
+
+    data.materials.resize(header.material_count);
+    for (MeshMaterialDesc& m : data.materials) {
+        MaterialRecord record;
+        if (!in.read(&record, 1)
+            || !in.read(m.diffuse_texname, record.diffuse_texname_length)
+            || !in.read(m.normal_texname, record.normal_texname_length)) {
+            return false;
+        }
+        m.illum = record.illum;
+        std::memcpy(m.diffuse, record.diffuse, sizeof(m.diffuse));
+        std::memcpy(m.specular, record.specular, sizeof(m.specular));
+        std::memcpy(m.transmittance, record.transmittance, sizeof(m.transmittance));
+        m.ior = record.ior;
+        m.shininess = record.shininess;
+    }
+
+    if (!valid_cache_data(data)) {
+        std::cerr << "[MeshCache] Warning: " << cache_path << " is corrupt, parsing the OBJ again." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+inline void write_cache(const std::string& cache_path, uint64_t key, const MeshData& data) {
+    // Meshes load concurrently: write a private file and rename it into place, so a reader
+    // (or another task loading the same OBJ) never sees a partial cache
+    std::ostringstream tmp_name;
+    tmp_name << cache_path << ".tmp" << std::this_thread::get_id();
+    const std::string tmp_path = tmp_name.str();
+    std::ofstream out(tmp_path, std::ios::binary);
+    if (!out) {
+        std::cerr << "[MeshCache] Warning: cannot write " << cache_path << std::endl;
+        return;
+    }
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.key = key;
+    header.vertex_count = static_cast<uint32_t>(data.positions.size());
+    header.triangle_count = static_cast<uint32_t>(data.triangle_count());
+    header.material_count = static_cast<uint32_t>(data.materials.size());
+    header.node_count = static_cast<uint32_t>(data.bvh.nodes.size());
+
+    auto write = [&](const void* p, size_t bytes) { out.write(reinterpret_cast<const char*>(p), bytes); };
+    write(&header, sizeof(header));
+    write(data.positions.data(), data.positions.size() * sizeof(glm::vec3));
+    write(data.normals.data(), data.normals.size() * sizeof(glm::vec3));
+    write(data.uvs.data(), data.uvs.size() * sizeof(glm::vec2));
+    write(data.indices.data(), data.indices.size() * sizeof(uint32_t));
+    write(data.material_ids.data(), data.material_ids.size() * sizeof(int32_t));
+    write(data.bvh.nodes.data(), data.bvh.nodes.size() * sizeof(FlatBVHNode));
+
+    for (const MeshMaterialDesc& m : data.materials) {
+        MaterialRecord record{};
+        record.illum = m.illum;
+        std::memcpy(record.diffuse, m.diffuse, sizeof(m.diffuse));
+        std::memcpy(record.specular, m.specular, sizeof(m.specular));
+        std::memcpy(record.transmittance, m.transmittance, sizeof(m.transmittance));
+        record.ior = m.ior;
+        record.shininess = m.shininess;
+        record.diffuse_texname_length = static_cast<uint32_t>(m.diffuse_texname.size());
+        record.normal_texname_length = static_cast<uint32_t>(m.normal_texname.size());
+        write(&record, sizeof(record));
+        write(m.diffuse_texname.data(), m.diffuse_texname.size());
+        write(m.normal_texname.data(), m.normal_texname.size());
+    }
+
+    out.close();
+    std::error_code ec;
+    if (out.fail()) std::filesystem::remove(tmp_path, ec);
+    else std::filesystem::rename(tmp_path, cache_path, ec);
+    if (ec || out.fail()) std::cerr << "[MeshCache] Warning: cannot write " << cache_path << std::endl;
+}
+
+/**
+ * @brief Parse the OBJ with tinyobj, weld (position, normal, uv) triples into indexed vertices
+ * and build the BVH. Non-triangular faces are skipped.
+ */
+inline bool parse_obj(const std::string& filename, const std::string& base_dir, MeshData& data) {
+    tinyobj::ObjReaderConfig reader_config;
+    reader_config.mtl_search_path = base_dir; // Search for .mtl in the same directory as the .obj
+
+    tinyobj::ObjReader reader;
+    if (!reader.ParseFromFile(filename, reader_config)) {
+        if (!reader.Error().empty()) {
+            std::cerr << "TinyObjReader Error: " << reader.Error();
+        }
+        return false;
+    }
+    if (!reader.Warning().empty()) {
+        std::cout << "TinyObjReader Warning: " << reader.Warning();
+    }
+
+    const auto& attrib = reader.GetAttrib();
+    const auto& shapes = reader.GetShapes();
+
+    for (const auto& m : reader.GetMaterials()) {
+        MeshMaterialDesc desc;
+        desc.illum = m.illum;
+        for (int c = 0; c < 3; ++c) {
+            desc.diffuse[c] = m.diffuse[c];
+            desc.specular[c] = m.specular[c];
+            desc.transmittance[c] = m.transmittance[c];
+        }
+        desc.ior = m.ior;
+        desc.shininess = m.shininess;
+        desc.diffuse_texname = m.diffuse_texname;
+        // Blender typically exports normal maps to 'norm' or 'map_Kn';
+        // tinyobj may parse generic bump maps into bump_texname instead.
+        desc.normal_texname = !m.normal_texname.empty() ? m.normal_texname : m.bump_texname;
+        data.materials.push_back(std::move(desc));
+    }
+
+    struct IndexHash {
+        size_t operator()(const tinyobj::index_t& i) const {
+            return fnv1a_64(&i, sizeof(i));
+        }
+    };
+    struct IndexEqual {
+        bool operator()(const tinyobj::index_t& a, const tinyobj::index_t& b) const {
+            return a.vertex_index == b.vertex_index && a.normal_index == b.normal_index && a.texcoord_index == b.texcoord_index;
+        }
+    };
+    std::unordered_map<tinyobj::index_t, uint32_t, IndexHash, IndexEqual> welded;
+
+    auto vertex_of = [&](const tinyobj::index_t& idx) {
+        auto it = welded.find(idx);
+        if (it != welded.end()) return it->second;
+
+        uint32_t id = static_cast<uint32_t>(data.positions.size());
+        data.positions.emplace_back(attrib.vertices[3 * size_t(idx.vertex_index) + 0],
+                                    attrib.vertices[3 * size_t(idx.vertex_index) + 1],
+                                    attrib.vertices[3 * size_t(idx.vertex_index) + 2]);
+        data.normals.push_back(idx.normal_index >= 0
+            ? glm::vec3(attrib.normals[3 * size_t(idx.normal_index) + 0],
+                        attrib.normals[3 * size_t(idx.normal_index) + 1],
+                        attrib.normals[3 * size_t(idx.normal_index) + 2])
+            : glm::vec3(0.0f));
+        data.uvs.push_back(idx.texcoord_index >= 0
+            ? glm::vec2(attrib.texcoords[2 * size_t(idx.texcoord_index) + 0],
+                        attrib.texcoords[2 * size_t(idx.texcoord_index) + 1])
+            : glm::vec2(0.0f));
+        welded.emplace(idx, id);
+        return id;
+    };
+
+    std::vector<uint32_t> indices;
+    std::vector<int32_t> material_ids;
+    for (const auto& shape : shapes) {
+        size_t index_offset = 0;
+        for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); f++) {
+            size_t fv = size_t(shape.mesh.num_face_vertices[f]);
+            if (fv == 3) {
+                for (size_t k = 0; k < 3; ++k) indices.push_back(vertex_of(shape.mesh.indices[index_offset + k]));
+                material_ids.push_back(shape.mesh.material_ids[f]);
+            }
+            index_offset += fv;
+        }
+    }
+
+    // Build the BVH and store the triangles in leaf order
+    size_t count = material_ids.size();
+    std::vector<AABB> bounds(count);
+    for (size_t t = 0; t < count; ++t) {
+        const glm::vec3& a = data.positions[indices[3 * t + 0]];
+        const glm::vec3& b = data.positions[indices[3 * t + 1]];
+        const glm::vec3& c = data.positions[indices[3 * t + 2]];
+        bounds[t] = AABB(glm::min(a, glm::min(b, c)), glm::max(a, glm::max(b, c)));
+    }
+    std::vector<uint32_t> order;
+    data.bvh.build(bounds, order);
+
+    data.indices.resize(3 * count);
+    data.material_ids.resize(count);
+    for (size_t t = 0; t < count; ++t) {
+        for (int k = 0; k < 3; ++k) data.indices[3 * t + k] = indices[3 * size_t(order[t]) + k];
+        data.material_ids[t] = material_ids[order[t]];
+    }
+    return true;
+}
+
+} // namespace mesh_cache_detail
+
+/**
+ * @brief Load an OBJ file as indexed, BVH-ordered mesh data.
+ *
+ * The first load parses the OBJ and writes "<filename>.meshcache" next to it; later loads map
+ * that file and copy the arrays straight out, skipping parsing, welding and the BVH build.
+ * The cache is keyed by an FNV-1a hash of the OBJ and MTL contents, so edits invalidate it.
+ * Data stays in object space: callers apply their transform and refit the BVH.
+ */
+inline bool load_mesh_data(const std::string& filename, MeshData& data, bool use_cache = true) {
+    auto last_slash = filename.find_last_of("/\\");
+    std::string base_dir = (last_slash != std::string::npos) ? filename.substr(0, last_slash + 1) : "./";
+
+    MappedFile obj(filename);
+    if (!obj.is_open()) {
+        std::cerr << "ERROR: Could not open mesh file '" << filename << "'.\n";
+        return false;
+    }
+
+    uint64_t key = mesh_cache_detail::source_key(obj, base_dir);
+    std::string cache_path = filename + ".meshcache";
+    if (use_cache && mesh_cache_detail::read_cache(cache_path, key, data)) {
+        std::cout << "[MeshCache] Loaded " << data.triangle_count() << " triangles from " << cache_path << std::endl;
+        return true;
+    }
+
+    data = MeshData();
+    if (!mesh_cache_detail::parse_obj(filename, base_dir, data)) return false;
+    if (use_cache) mesh_cache_detail::write_cache(cache_path, key, data);
+    return true;
+}
@@ -7,4 +7,5 @@
 #include "cone.hpp"
 #include "disk.hpp"
 #include "triangle.hpp"
-#include "volume.hpp"
\ No newline at end of file
+#include "volume.hpp"
+#include "grid_medium.hpp"
\ No newline at end of file
@@ -1,11 +1,13 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <functional>
 #include <memory>
 #include "../core/utils.hpp"
 #include "../core/ray.hpp"
 #include "../accel/AABB.hpp"
 #include "../core/record.hpp"
+#include "../core/medium.hpp"
 
 /**
  * @brief Abstract base class for all renderable objects in the scene.
@@ -52,6 +54,32 @@ public:
      */
     virtual glm::vec3 random_pointing_vector(const glm::vec3& origin) const = 0;
 
+    /**
+     * @brief PDF of direction v when the hit of the ray (origin, v) on this object is already known.
+     * Shapes override this with an analytic solid angle PDF from rec.p / rec.normal, avoiding a second ray cast.
+     * The default falls back to pdf_value(origin, v), which re-intersects.
+     * 
+     * @param rec The intersection of the ray (origin, v) with this object.
+     */
+    virtual float pdf_value(const glm::vec3& origin, const glm::vec3& v, const HitRecord& rec) const {
+        return pdf_value(origin, v);
+    }
+
+    /**
+     * @brief Same as random_pointing_vector, but also returns the solid angle PDF of the sampled direction.
+     * Shapes override this to compute the PDF from the sampled point directly instead of re-intersecting.
+     * 
+     * @param origin The point from which we are viewing the object.
+     * @param pdf [out] Solid angle PDF of the returned direction (0 if the sample is invalid).
+     * @return glm::vec3 Vector P_surface - origin.
+     */
+    virtual glm::vec3 random_pointing_vector(const glm::vec3& origin, float& pdf) const {
+        glm::vec3 v = random_pointing_vector(origin);
+        float dist = glm::length(v);
+        pdf = (dist > EPSILON) ? pdf_value(origin, v / dist) : 0.0f;
+        return v;
+    }
+
     /**
      * @brief Randomly sample a point and normal on the surface of object.
      * @param pos [out] Sampled point (world space)
@@ -65,6 +93,25 @@ public:
      */
     virtual Material* get_material() const = 0;
 
+    /**
+     * @brief Call 'fn' for every material a hit on this object can report.
+     * Single-material objects use get_material(); objects with per-face materials list them all.
+     */
+    virtual void for_each_material(const std::function<void(const Material&)>& fn) const {
+        if (const Material* mat = get_material()) fn(*mat);
+    }
+
+    /**
+     * @brief Media on both sides if this object is a medium boundary (hits without a material).
+     */
+    virtual const MediumInterface* get_medium_interface() const { return nullptr; }
+
+    /**
+     * @brief Block until data loaded in the background (TaskGraph) is in place.
+     * Must be called before anything else reads the object; Scene::add / build_bvh do so.
+     */
+    virtual void finish_loading() {}
+
     /**
      * @brief Set the Light Index for Importance Sampling.
      * -1 means this object is not a light source.
@@ -3,10 +3,43 @@
 #include "object_utils.hpp"
 #include "../core/onb.hpp"
 
+/**
+ * @brief Ray-sphere roots in single precision without catastrophic cancellation.
+ * The discriminant is computed from the distance between the center and the ray's closest approach
+ * (instead of b^2 - ac), and the second root from c / q (instead of subtracting nearly equal terms),
+ * following "Precision Improvements for Ray/Sphere Intersection" (Ray Tracing Gems, ch. 7).
+ * This keeps large spheres (ground planes) free of striping without falling back to double.
+ *
+ * @param t [out] Nearest root inside [t_min, t_max].
+ */
+inline bool intersect_sphere(const glm::vec3& origin, const glm::vec3& dir, const glm::vec3& center, float radius,
+                             float t_min, float t_max, float& t) {
+    glm::vec3 f = origin - center;
+    float a = glm::dot(dir, dir);
+    float b = -glm::dot(f, dir);              // Half of the usual -b
+    glm::vec3 l = f + (b / a) * dir;          // Center to closest approach
+    float discriminant = radius * radius - glm::dot(l, l);
+    if (discriminant < 0.0f) return false;
+
+    float c = glm::dot(f, f) - radius * radius;
+    float q = b + std::copysign(std::sqrt(a * discriminant), b);
+    float t0 = (q != 0.0f) ? c / q : 0.0f;
+    float t1 = q / a;
+    if (t0 > t1) std::swap(t0, t1);
+
+    t = t0;
+    if (t < t_min || t > t_max) {
+        t = t1;
+        if (t < t_min || t > t_max)
+            return false;
+    }
+    return true;
+}
+
 /**
  * @brief A Sphere object defined by a center and a radius.
  */
-class Sphere : public Object {
+class Sphere final : public Object {
 public:
     Sphere() {}
     
@@ -21,36 +54,28 @@ public:
         : center(cen), radius(r), mat_ptr(m) {};
 
     /**
-     * @brief Double precision ray-sphere intersection to reduce artifacts.
+     * @brief Ray-sphere intersection (robust single precision, see intersect_sphere).
      */
     virtual bool intersect(const Ray& r, float t_min, float t_max, HitRecord& rec) const override {
-        glm::vec3 oc = r.origin() - center;
-        
-        // Use double precision to prevent striping artifacts on large spheres (like the ground)
-        double a = glm::dot(r.direction(), r.direction());
-        double half_b = glm::dot(oc, r.direction());
-        double c = glm::dot(oc, oc) - double(radius) * double(radius); // Cast to double before multiplication
-        
-        double discriminant = half_b * half_b - a * c;
-        if (discriminant < 0) return false;
-        
-        double sqrtd = sqrt(discriminant);
-
-        // Find the nearest root that lies in the acceptable range.
-        double root = (-half_b - sqrtd) / a;
-        if (root < t_min || root > t_max) {
-            root = (-half_b + sqrtd) / a;
-            if (root < t_min || root > t_max)
-                return false;
-        }
+        float t;
+        if (!intersect_sphere(r.origin(), r.direction(), center, radius, t_min, t_max, t))
+            return false;
+        fill_record(r, t, rec);
+        return true;
+    }
 
-        // Cast back to float for the record
-        rec.t = static_cast<float>(root);
+    /**
+     * @brief Fill the hit record for a known root 't' (shared with the batched kernels of PrimitiveSet).
+     */
+    void fill_record(const Ray& r, float t, HitRecord& rec) const {
+        rec.t = t;
         rec.p = r.at(rec.t);
         
         glm::vec3 outward_normal = (rec.p - center) / radius;
         rec.set_face_normal(r, outward_normal);
         get_sphere_uv(outward_normal, rec.u, rec.v); 
+        // u spans the equator (2*PI*R), v a meridian (PI*R): use their geometric mean
+        rec.uv_scale = 1.0f / (std::sqrt(2.0f) * PI * radius);
 
         // Compute Tangent for Spherical Mapping
         // The tangent should point in the direction of increasing U (around the Y axis).
@@ -65,9 +90,8 @@ public:
         
         rec.mat_ptr = mat_ptr.get();
         rec.object = this;
-
-        return true;
     }
+
     /**
      * @brief Find the AABB of a sphere.
      */
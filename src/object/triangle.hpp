@@ -2,6 +2,190 @@
 
 #include "object_utils.hpp"
 
+/**
+ * @brief Möller–Trumbore ray / triangle test, shared by Triangle and indexed triangle meshes.
+ *
+ * @param t [out] Ray parameter of the hit.
+ * @param b1 [out] Barycentric weight of v1.
+ * @param b2 [out] Barycentric weight of v2.
+ */
+inline bool intersect_triangle(const Ray& r, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2,
+                               float t_min, float t_max, float& t, float& b1, float& b2) {
+    glm::vec3 edge1 = v1 - v0;
+    glm::vec3 edge2 = v2 - v0;
+    glm::vec3 pvec = glm::cross(r.direction(), edge2);
+
+    float det = glm::dot(edge1, pvec);
+    if (std::abs(det) < EPSILON) return false; // Culling or degenerate
+
+    float inv_det = 1.0f / det;
+    glm::vec3 tvec = r.origin() - v0;
+
+    b1 = glm::dot(tvec, pvec) * inv_det;
+    if (b1 < 0.0f || b1 > 1.0f) return false;
+
+    glm::vec3 qvec = glm::cross(tvec, edge1);
+    b2 = glm::dot(r.direction(), qvec) * inv_det;
+    if (b2 < 0.0f || b1 + b2 > 1.0f) return false;
+
+    t = glm::dot(edge2, qvec) * inv_det;
+    return t >= t_min && t <= t_max;
+}
+
+/**
+ * @brief Tangent aligned with the U direction, for normal mapping.
+ */
+inline glm::vec3 triangle_tangent(const glm::vec3& edge1, const glm::vec3& edge2, const glm::vec2& delta_uv1, const glm::vec2& delta_uv2) {
+    float f = 1.0f / (delta_uv1.x * delta_uv2.y - delta_uv2.x * delta_uv1.y + EPSILON);
+    return glm::normalize(f * (delta_uv2.y * edge1 - delta_uv1.y * edge2));
+}
+
+/**
+ * @brief UV units per world unit, sqrt(UV area / world area), for texture footprints.
+ */
+inline float triangle_uv_scale(float area, const glm::vec2& delta_uv1, const glm::vec2& delta_uv2) {
+    float uv_area = 0.5f * std::abs(delta_uv1.x * delta_uv2.y - delta_uv2.x * delta_uv1.y);
+    return (area > 0.0f) ? std::sqrt(uv_area / area) : 0.0f;
+}
+
+/**
+ * @brief Solid angle subtended by the triangle (v0, v1, v2) as seen from 'origin'.
+ * Van Oosterom & Strackee formula on the three normalized vertex directions.
+ */
+inline float triangle_solid_angle(const glm::vec3& origin, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2) {
+    glm::vec3 a = glm::normalize(v0 - origin);
+    glm::vec3 b = glm::normalize(v1 - origin);
+    glm::vec3 c = glm::normalize(v2 - origin);
+    return std::abs(2.0f * std::atan2(glm::dot(a, glm::cross(b, c)),
+                                      1.0f + glm::dot(a, b) + glm::dot(a, c) + glm::dot(b, c)));
+}
+
+/**
+ * @brief Whether directions towards a triangle are drawn by spherical triangle sampling.
+ * Sampling and PDF evaluation must agree on this choice.
+ */
+inline bool use_spherical_triangle_sampling(float omega) {
+    return omega >= MIN_SPHERICAL_SAMPLE_AREA && omega <= MAX_SPHERICAL_SAMPLE_AREA;
+}
+
+/**
+ * @brief Solid angle PDF of reaching point 'p' on a triangle by uniform area sampling.
+ */
+inline float triangle_area_pdf(const glm::vec3& origin, const glm::vec3& p, const glm::vec3& face_normal, float area) {
+    glm::vec3 d = p - origin;
+    float distance_squared = glm::dot(d, d);
+    if (distance_squared < EPSILON) return 0.0f;
+
+    float cosine = std::abs(glm::dot(d, face_normal)) / std::sqrt(distance_squared);
+    if (cosine < EPSILON) return 0.0f;
+    return distance_squared / (area * cosine);
+}
+
+/**
+ * @brief Arvo's stratified sampling of the spherical triangle subtended by (v0, v1, v2).
+ * See "Stratified Sampling of Spherical Triangles" (Arvo, 1995) and pbrt-v4 SampleSphericalTriangle.
+ * 
+ * @param origin The viewing point.
+ * @param u0 Random number selecting the sub-triangle area.
+ * @param u1 Random number selecting the position along the final arc.
+ * @return glm::vec3 Normalized direction from origin towards the triangle.
+ */
+inline glm::vec3 sample_spherical_triangle(const glm::vec3& origin, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2,
+                                           float u0, float u1) {
+    glm::vec3 a = glm::normalize(v0 - origin);
+    glm::vec3 b = glm::normalize(v1 - origin);
+    glm::vec3 c = glm::normalize(v2 - origin);
+
+    // Normals of the great circles through each pair of vertices
+    glm::vec3 n_ab = glm::cross(a, b);
+    glm::vec3 n_bc = glm::cross(b, c);
+    glm::vec3 n_ca = glm::cross(c, a);
+    if (near_zero(n_ab) || near_zero(n_bc) || near_zero(n_ca)) return a;
+    n_ab = glm::normalize(n_ab);
+    n_bc = glm::normalize(n_bc);
+    n_ca = glm::normalize(n_ca);
+
+    // Interior angles of the spherical triangle
+    float alpha = angle_between(n_ab, -n_ca);
+    float beta = angle_between(n_bc, -n_ab);
+    float gamma = angle_between(n_ca, -n_bc);
+
+    // Pick the area A' of the sub-triangle uniformly in [0, A]
+    float a_pi = alpha + beta + gamma;
+    float ap_pi = PI + u0 * (a_pi - PI);
+
+    // Find cos(beta') of the vertex c' on arc AC that produces the sampled area
+    float cos_alpha = std::cos(alpha);
+    float sin_alpha = std::sin(alpha);
+    float sin_phi = std::sin(ap_pi) * cos_alpha - std::cos(ap_pi) * sin_alpha;
+    float cos_phi = std::cos(ap_pi) * cos_alpha + std::sin(ap_pi) * sin_alpha;
+    float k1 = cos_phi + cos_alpha;
+    float k2 = sin_phi - sin_alpha * glm::dot(a, b);
+    float denom = (k2 * sin_phi + k1 * cos_phi) * sin_alpha;
+    float cos_bp = (std::abs(denom) > 0.0f) ? (k2 + (k2 * cos_phi - k1 * sin_phi) * cos_alpha) / denom : 1.0f;
+    cos_bp = std::clamp(cos_bp, -1.0f, 1.0f);
+
+    float sin_bp = std::sqrt(std::max(0.0f, 1.0f - cos_bp * cos_bp));
+    glm::vec3 ca_perp = gram_schmidt(c, a);
+    if (near_zero(ca_perp)) return a;
+    glm::vec3 c_prime = cos_bp * a + sin_bp * glm::normalize(ca_perp);
+
+    // Sample uniformly along the arc from b to c'
+    float cos_theta = 1.0f - u1 * (1.0f - glm::dot(c_prime, b));
+    float sin_theta = std::sqrt(std::max(0.0f, 1.0f - cos_theta * cos_theta));
+    glm::vec3 cb_perp = gram_schmidt(c_prime, b);
+    if (near_zero(cb_perp)) return b;
+    return glm::normalize(cos_theta * b + sin_theta * glm::normalize(cb_perp));
+}
+
+/**
+ * @brief Sample a point on the triangle (v0, v1, v2) as seen from 'origin'.
+ * Uses spherical triangle sampling so that directions are uniform in solid angle,
+ * which removes the 1/cos and distance variance of area sampling for nearby / grazing lights;
+ * tiny or huge solid angles fall back to uniform area sampling.
+ *
+ * @param pdf [out] Solid angle PDF of the returned direction.
+ * @return glm::vec3 Vector from origin to the sampled point (not normalized).
+ */
+inline glm::vec3 sample_triangle_direction(const glm::vec3& origin, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, float& pdf) {
+    glm::vec3 cross = glm::cross(v1 - v0, v2 - v0);
+    float area = 0.5f * glm::length(cross);
+    glm::vec3 face_normal = glm::normalize(cross);
+
+    float omega = triangle_solid_angle(origin, v0, v1, v2);
+    if (!use_spherical_triangle_sampling(omega)) {
+        float sqrt_r1 = sqrt(random_float());
+        float r2 = random_float();
+        float u = 1.0f - sqrt_r1;
+        float v = r2 * sqrt_r1;
+        glm::vec3 random_point = (1.0f - u - v) * v0 + u * v1 + v * v2;
+        pdf = triangle_area_pdf(origin, random_point, face_normal, area);
+        return random_point - origin;
+    }
+
+    glm::vec3 dir = sample_spherical_triangle(origin, v0, v1, v2, random_float(), random_float());
+
+    // Intersect the sampled direction with the triangle plane to recover the surface point.
+    pdf = 0.0f;
+    float denom = glm::dot(dir, face_normal);
+    if (std::abs(denom) < EPSILON) return glm::vec3(0.0f);
+    float t = glm::dot(v0 - origin, face_normal) / denom;
+    if (t <= 0.0f) return glm::vec3(0.0f);
+    pdf = 1.0f / omega;
+    return dir * t;
+}
+
+/**
+ * @brief Solid angle PDF of sample_triangle_direction producing the known point 'p' on the triangle.
+ */
+inline float triangle_direction_pdf(const glm::vec3& origin, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, const glm::vec3& p) {
+    float omega = triangle_solid_angle(origin, v0, v1, v2);
+    if (use_spherical_triangle_sampling(omega))
+        return 1.0f / omega;
+    glm::vec3 cross = glm::cross(v1 - v0, v2 - v0);
+    return triangle_area_pdf(origin, p, glm::normalize(cross), 0.5f * glm::length(cross));
+}
+
 /**
  * @brief Triangle primitive.
  * Supports UV mapping and Optional Smooth Shading (Vertex Normals).
@@ -48,37 +232,18 @@ public:
         // Tangent calculation for Normal Mapping
         glm::vec2 delta_uv1 = uv1 - uv0;
         glm::vec2 delta_uv2 = uv2 - uv0;
-        float f = 1.0f / (delta_uv1.x * delta_uv2.y - delta_uv2.x * delta_uv1.y + EPSILON);
+        tangent = triangle_tangent(edge1, edge2, delta_uv1, delta_uv2);
 
-        tangent.x = f * (delta_uv2.y * edge1.x - delta_uv1.y * edge2.x);
-        tangent.y = f * (delta_uv2.y * edge1.y - delta_uv1.y * edge2.y);
-        tangent.z = f * (delta_uv2.y * edge1.z - delta_uv1.y * edge2.z);
-        tangent = glm::normalize(tangent);
+        // UV area per world area, for texture footprints
+        uv_scale = triangle_uv_scale(area, delta_uv1, delta_uv2);
     }
 
     /**
      * @brief Möller–Trumbore intersection algorithm.
      */
     virtual bool intersect(const Ray& r, float t_min, float t_max, HitRecord& rec) const override {
-        glm::vec3 edge1 = v1 - v0;
-        glm::vec3 edge2 = v2 - v0;
-        glm::vec3 pvec = glm::cross(r.direction(), edge2);
-        
-        float det = glm::dot(edge1, pvec);
-        if (std::abs(det) < EPSILON) return false; // Culling or degenerate
-        
-        float inv_det = 1.0f / det;
-        glm::vec3 tvec = r.origin() - v0;
-        
-        float u = glm::dot(tvec, pvec) * inv_det;
-        if (u < 0.0f || u > 1.0f) return false;
-
-        glm::vec3 qvec = glm::cross(tvec, edge1);
-        float v = glm::dot(r.direction(), qvec) * inv_det;
-        if (v < 0.0f || u + v > 1.0f) return false;
-
-        float t = glm::dot(edge2, qvec) * inv_det;
-        if (t < t_min || t > t_max) return false;
+        float t, u, v;
+        if (!intersect_triangle(r, v0, v1, v2, t_min, t_max, t, u, v)) return false;
 
         rec.t = t;
         rec.p = r.at(t);
@@ -102,6 +267,7 @@ public:
         rec.v = w * uv0.y + u * uv1.y + v * uv2.y;
         
         rec.tangent = tangent;
+        rec.uv_scale = uv_scale;
         rec.mat_ptr = mat_ptr.get();
         rec.object = this;
 
@@ -124,29 +290,42 @@ public:
         return true;
     }
 
+    /**
+     * @brief Solid angle subtended by the triangle as seen from 'origin'.
+     */
+    float solid_angle(const glm::vec3& origin) const {
+        return triangle_solid_angle(origin, v0, v1, v2);
+    }
+
     /**
      * @brief PDF for importance sampling this triangle (Area Light).
-     * pdf = distance_squared / (area * cos_theta)
+     * Solid angle sampling: pdf = 1 / solid_angle.
+     * Area sampling fallback: pdf = distance_squared / (area * cos_theta)
      */
     virtual float pdf_value(const glm::vec3& origin, const glm::vec3& v) const override {
         HitRecord rec;
         if (!this->intersect(Ray(origin, v), 0.001f, Infinity, rec))
             return 0.0f;
-        float distance_squared = rec.t * rec.t * glm::dot(v, v);
-        float cosine = std::abs(glm::dot(v, rec.normal) / glm::length(v));
-        return distance_squared / (area * cosine);
+        return pdf_value(origin, v, rec);
     }
 
     /**
-     * @brief Randomly sample a point on the triangle surface.
+     * @brief Analytic PDF when the hit point on this triangle is already known.
      */
+    virtual float pdf_value(const glm::vec3& origin, const glm::vec3& v, const HitRecord& rec) const override {
+        return triangle_direction_pdf(origin, v0, v1, v2, rec.p);
+    }
+
     virtual glm::vec3 random_pointing_vector(const glm::vec3& origin) const override {
-        float sqrt_r1 = sqrt(random_float());
-        float r2 = random_float();
-        float u = 1.0f - sqrt_r1;
-        float v = r2 * sqrt_r1;
-        glm::vec3 random_point = (1.0f - u - v) * v0 + u * v1 + v * v2;
-        return random_point - origin;
+        float pdf;
+        return random_pointing_vector(origin, pdf);
+    }
+
+    /**
+     * @brief Randomly sample a point on the triangle, seen from 'origin' (solid angle sampling).
+     */
+    virtual glm::vec3 random_pointing_vector(const glm::vec3& origin, float& pdf) const override {
+        return sample_triangle_direction(origin, v0, v1, v2, pdf);
     }
 
     /**
@@ -174,6 +353,7 @@ public:
     glm::vec3 face_normal;
     glm::vec3 tangent;
     float area;
+    float uv_scale; // sqrt(UV area / world area)
     std::shared_ptr<Material> mat_ptr;
     bool use_vertex_normals;
 };
\ No newline at end of file
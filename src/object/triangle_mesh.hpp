@@ -0,0 +1,308 @@
+#pragma once
+
+#include "triangle.hpp"
+#include "obj_loader.hpp"
+#include "../accel/flat_bvh.hpp"
+#include "../core/distribution.hpp"
+#include "../material/material_utils.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+/**
+ * @brief Compact indexed triangle storage shared by Mesh and MovingMesh.
+ *
+ * Vertices live once in shared position / normal / UV arrays, triangles are three 32-bit indices
+ * plus a 16-bit slot in a small material table, and the FlatBVH addresses triangles by index.
+ * Arrays that would only hold defaults are dropped: normals of flat meshes, UVs of untextured
+ * ones and the material slots of single-material meshes.
+ * No per-face Triangle objects are created: traversal only computes (t, b1, b2) and the hit record
+ * (normals, UVs, tangent, material) is filled once, for the closest triangle.
+ */
+class TriangleMesh {
+public:
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;       // Per vertex, zero when the OBJ had none (flat shading); empty if none has
+    std::vector<glm::vec2> uvs;           // Per vertex; empty when the OBJ has no texcoords
+    std::vector<uint32_t> indices;        // 3 per triangle, in BVH leaf order
+    std::vector<uint16_t> material_ids;   // Slot in 'materials', per triangle; empty when every face uses slot 0
+    std::vector<std::shared_ptr<Material>> materials;
+    FlatBVH bvh;
+
+    size_t triangle_count() const { return indices.size() / 3; }
+    bool empty() const { return indices.empty(); }
+    uint16_t material_slot(size_t f) const { return material_ids.empty() ? 0 : material_ids[f]; }
+    AABB bounds() const { return bvh.bounds(); }
+    float get_area() const { return total_area; }
+
+    /**
+     * @brief Take over the loaded (already transformed) geometry and resolve per-face materials.
+     *
+     * @param data Indexed mesh data, consumed.
+     * @param face_materials Materials indexed by the OBJ material ids (ignored if 'global_mat' is set).
+     * @param global_mat Override for every face, may be nullptr.
+     * @param fallback_mat Used for faces without a valid material id.
+     */
+    void build(MeshData& data, const std::vector<std::shared_ptr<Material>>& face_materials,
+               std::shared_ptr<Material> global_mat, std::shared_ptr<Material> fallback_mat) {
+        positions = std::move(data.positions);
+        normals = std::move(data.normals);
+        uvs = std::move(data.uvs);
+        indices = std::move(data.indices);
+        if (std::all_of(normals.begin(), normals.end(), [](const glm::vec3& n) { return n == glm::vec3(0.0f); }))
+            normals.clear();
+        if (std::all_of(uvs.begin(), uvs.end(), [](const glm::vec2& uv) { return uv == glm::vec2(0.0f); }))
+            uvs.clear();
+        // A freshly parsed OBJ leaves growth slack in the arrays
+        positions.shrink_to_fit();
+        normals.shrink_to_fit();
+        uvs.shrink_to_fit();
+        indices.shrink_to_fit();
+
+        // Slot 0 is the override or the fallback, OBJ materials follow
+        materials.clear();
+        materials.push_back(global_mat ? global_mat : fallback_mat);
+        if (!global_mat) materials.insert(materials.end(), face_materials.begin(), face_materials.end());
+
+        size_t n = data.triangle_count();
+        material_ids.resize(n);
+        for (size_t f = 0; f < n; ++f) {
+            int mat_id = global_mat ? -1 : data.material_ids[f];
+            bool valid = mat_id >= 0 && mat_id < static_cast<int>(face_materials.size()) && mat_id + 1 <= UINT16_MAX;
+            material_ids[f] = valid ? static_cast<uint16_t>(mat_id + 1) : 0;
+        }
+        if (std::all_of(material_ids.begin(), material_ids.end(), [](uint16_t id) { return id == 0; }))
+            material_ids.clear();
+        material_ids.shrink_to_fit();
+
+        if (n == 0) return;
+
+        // The cached hierarchy is in object space: keep its topology, recompute the bounds
+        bvh = std::move(data.bvh);
+        bvh.nodes.shrink_to_fit();
+        refit_bvh();
+
+        build_distributions();
+    }
+
+    /**
+     * @brief Move the mesh by 'transform' relative to its loaded pose, then refit the BVH bottom-up.
+     * The loaded pose is kept on first use, so a sequence of transforms does not accumulate error.
+     */
+    void set_transform(const glm::mat4& transform) {
+        if (empty()) return;
+        if (rest_positions.empty()) {
+            rest_positions = positions;
+            rest_normals = normals;
+        }
+
+        const glm::mat3 normal_mat = glm::mat3(glm::transpose(glm::inverse(transform)));
+        #pragma omp parallel for schedule(static)
+        for (long long i = 0; i < (long long)positions.size(); ++i) {
+            positions[i] = glm::vec3(transform * glm::vec4(rest_positions[i], 1.0f));
+            if (!rest_normals.empty() && rest_normals[i] != glm::vec3(0.0f)) normals[i] = glm::normalize(normal_mat * rest_normals[i]);
+        }
+        refit_bvh();
+        build_distributions(); // Triangle areas change under scaling
+    }
+
+    /**
+     * @brief Closest hit against all triangles; 'owner' becomes rec.object and rec.prim_id the triangle.
+     */
+    bool intersect(const Ray& r, float t_min, float t_max, HitRecord& rec, const Object* owner) const {
+        int hit_prim = -1;
+        float hit_b1 = 0.0f, hit_b2 = 0.0f;
+        bvh.intersect(r, t_min, t_max, [&](int i, float& closest) {
+            glm::vec3 v0, v1, v2;
+            vertices(i, v0, v1, v2);
+            float t, b1, b2;
+            if (!intersect_triangle(r, v0, v1, v2, t_min, closest, t, b1, b2)) return false;
+            closest = t;
+            hit_prim = i;
+            hit_b1 = b1;
+            hit_b2 = b2;
+            return true;
+        });
+        if (hit_prim < 0) return false;
+
+        const uint32_t* idx = &indices[3 * size_t(hit_prim)];
+        const glm::vec3& v0 = positions[idx[0]];
+        glm::vec3 edge1 = positions[idx[1]] - v0;
+        glm::vec3 edge2 = positions[idx[2]] - v0;
+        glm::vec3 cross = glm::cross(edge1, edge2);
+        float b0 = 1.0f - hit_b1 - hit_b2;
+
+        rec.t = t_max;
+        rec.p = r.at(t_max);
+
+        // Interpolated normal only if all three vertices carry one
+        glm::vec3 shading_normal = glm::normalize(cross);
+        if (!normals.empty()) {
+            const glm::vec3& n0 = normals[idx[0]];
+            const glm::vec3& n1 = normals[idx[1]];
+            const glm::vec3& n2 = normals[idx[2]];
+            if (n0 != glm::vec3(0.0f) && n1 != glm::vec3(0.0f) && n2 != glm::vec3(0.0f))
+                shading_normal = glm::normalize(b0 * n0 + hit_b1 * n1 + hit_b2 * n2);
+        }
+        rec.set_face_normal(r, shading_normal);
+
+        glm::vec2 uv0(0.0f), delta_uv1(0.0f), delta_uv2(0.0f);
+        if (!uvs.empty()) {
+            uv0 = uvs[idx[0]];
+            delta_uv1 = uvs[idx[1]] - uv0;
+            delta_uv2 = uvs[idx[2]] - uv0;
+        }
+        glm::vec2 uv = uv0 + hit_b1 * delta_uv1 + hit_b2 * delta_uv2;
+        rec.u = uv.x;
+        rec.v = uv.y;
+
+        rec.tangent = triangle_tangent(edge1, edge2, delta_uv1, delta_uv2);
+        rec.uv_scale = triangle_uv_scale(0.5f * glm::length(cross), delta_uv1, delta_uv2);
+        rec.mat_ptr = materials[material_slot(hit_prim)].get();
+        rec.object = owner;
+        rec.prim_id = hit_prim;
+        return true;
+    }
+
+    /**
+     * @brief Uniform point on the surface: area weighted triangle choice, then uniform barycentrics.
+     */
+    void sample_surface(glm::vec3& pos, glm::vec3& normal, float& area) const {
+        if (!area_distribution) {
+            area = 0.0f;
+            return;
+        }
+
+        float pdf_choice;
+        float u_remapped;
+        int i = area_distribution->sample_discrete(random_float(), pdf_choice, u_remapped);
+
+        glm::vec3 v0, v1, v2;
+        vertices(i, v0, v1, v2);
+        float sqrt_r1 = sqrt(random_float());
+        float r2 = random_float();
+        float u = 1.0f - sqrt_r1;
+        float v = r2 * sqrt_r1;
+        pos = (1.0f - u - v) * v0 + u * v1 + v * v2;
+        normal = glm::normalize(glm::cross(v1 - v0, v2 - v0));
+        area = total_area;
+    }
+
+    /**
+     * @brief Pick a triangle proportionally to its emitted power, then sample it by solid angle.
+     */
+    glm::vec3 sample_direction(const glm::vec3& origin, float& pdf) const {
+        pdf = 0.0f;
+        if (!light_distribution()) return glm::vec3(0.0f);
+
+        float pdf_choice;
+        float u_remapped;
+        int i = light_distribution()->sample_discrete(random_float(), pdf_choice, u_remapped);
+
+        glm::vec3 v0, v1, v2;
+        vertices(i, v0, v1, v2);
+        float pdf_dir;
+        glm::vec3 v = sample_triangle_direction(origin, v0, v1, v2, pdf_dir);
+        pdf = pdf_choice * pdf_dir;
+        return v;
+    }
+
+    /**
+     * @brief Combined PDF P(select triangle 'prim') * p(direction | triangle) for the known hit point 'p'.
+     */
+    float pdf(const glm::vec3& origin, int prim, const glm::vec3& p) const {
+        if (!light_distribution() || prim < 0) return 0.0f;
+        glm::vec3 v0, v1, v2;
+        vertices(prim, v0, v1, v2);
+        return light_distribution()->pdf_discrete(prim) * triangle_direction_pdf(origin, v0, v1, v2, p);
+    }
+
+    /**
+     * @brief Bytes held by the geometry and the hierarchy.
+     */
+    size_t memory_usage() const {
+        return (positions.capacity() + rest_positions.capacity()) * sizeof(glm::vec3) +
+               (normals.capacity() + rest_normals.capacity()) * sizeof(glm::vec3) +
+               uvs.capacity() * sizeof(glm::vec2) + indices.capacity() * sizeof(uint32_t) +
+               material_ids.capacity() * sizeof(uint16_t) + bvh.nodes.capacity() * sizeof(FlatBVHNode);
+    }
+
+    /**
+     * @brief Bytes held by the area and power sampling tables.
+     */
+    size_t sampling_memory_usage() const {
+        size_t bytes = 0;
+        for (const Distribution1D* d : {area_distribution.get(), power_distribution.get()}) {
+            if (d) bytes += d->func.capacity() * sizeof(float) + d->table.capacity() * sizeof(AliasBin);
+        }
+        return bytes;
+    }
+
+private:
+    std::unique_ptr<Distribution1D> area_distribution;  // Area weighted, for uniform surface sampling (every mesh)
+    std::unique_ptr<Distribution1D> power_distribution; // Power weighted, only for emissive meshes whose emission varies
+    float total_area = 0.0f;
+    std::vector<glm::vec3> rest_positions; // Loaded pose, only kept once set_transform() was used
+    std::vector<glm::vec3> rest_normals;
+
+    void vertices(int i, glm::vec3& v0, glm::vec3& v1, glm::vec3& v2) const {
+        const uint32_t* idx = &indices[3 * size_t(i)];
+        v0 = positions[idx[0]];
+        v1 = positions[idx[1]];
+        v2 = positions[idx[2]];
+    }
+
+    void refit_bvh() {
+        bvh.refit([&](int i) {
+            glm::vec3 v0, v1, v2;
+            vertices(i, v0, v1, v2);
+            glm::vec3 lo = glm::min(v0, glm::min(v1, v2));
+            glm::vec3 hi = glm::max(v0, glm::max(v1, v2));
+            return AABB(lo - glm::vec3(PADDING_EPSILON), hi + glm::vec3(PADDING_EPSILON));
+        });
+    }
+
+    const Distribution1D* light_distribution() const {
+        return power_distribution ? power_distribution.get() : area_distribution.get();
+    }
+
+    /**
+     * @brief Area table for every mesh (surface sampling, e.g. as a specular photon target); the power
+     * table only for meshes that can become lights (some material emits).
+     */
+    void build_distributions() {
+        bool emissive = false;
+        for (const auto& m : materials) emissive = emissive || (m && m->is_emissive());
+
+        size_t n = triangle_count();
+        std::vector<float> areas(n), powers(n);
+        bool uniform_emission = true;
+        float first_emission = -1.0f;
+        for (size_t f = 0; f < n; ++f) {
+            glm::vec3 v0, v1, v2;
+            vertices(static_cast<int>(f), v0, v1, v2);
+            areas[f] = 0.5f * glm::length(glm::cross(v1 - v0, v2 - v0));
+            if (!emissive) continue;
+
+            // Emitted power (up to a constant PI) used to pick triangles for light sampling
+            const uint32_t* idx = &indices[3 * f];
+            glm::vec3 centroid = (v0 + v1 + v2) / 3.0f;
+            glm::vec2 uv_centroid = uvs.empty() ? glm::vec2(0.0f) : (uvs[idx[0]] + uvs[idx[1]] + uvs[idx[2]]) / 3.0f;
+            float emission = grayscale(materials[material_slot(f)]->emitted(uv_centroid.x, uv_centroid.y, centroid));
+            powers[f] = areas[f] * emission;
+            if (first_emission < 0.0f) first_emission = emission;
+            uniform_emission = uniform_emission && emission == first_emission;
+        }
+
+        total_area = std::accumulate(areas.begin(), areas.end(), 0.0f);
+        area_distribution = std::make_unique<Distribution1D>(areas.data(), static_cast<int>(n));
+
+        // Uniformly emitting (or dark) meshes pick lights by area, so one table serves both
+        power_distribution.reset();
+        float total_power = std::accumulate(powers.begin(), powers.end(), 0.0f);
+        if (emissive && total_power > 0.0f && !uniform_emission)
+            power_distribution = std::make_unique<Distribution1D>(powers.data(), static_cast<int>(n));
+    }
+};
@@ -1,8 +1,10 @@
 #pragma once
 
 #include "object_utils.hpp"
+#include "../core/medium.hpp"
 #include "../material/isotropic_phase.hpp"
 #include "../texture/texture_utils.hpp"
+#include <cmath>
 #include <iostream>
 
 /**
@@ -10,12 +12,13 @@
  * Examples: Thin fog, colored water, smoke in a box.
  * 
  * Logic:
- * The ray hits the boundary object at t1 and t2.
- * The distance inside is d = t2 - t1.
- * We sample a random distance 'hit_distance' based on the density.
- * If hit_distance < d, the ray scattered INSIDE the volume.
+ * The object is the medium's boundary: intersect() reports the boundary hit without a material,
+ * and get_medium_interface() has this medium inside, vacuum outside. The integrator crosses it and
+ * samples free flights in the medium against the next surface hit only, so no extra boundary
+ * traversals are needed. The boundary must be closed and outward oriented; overlapping media are
+ * not supported (leaving one returns the ray to vacuum).
  */
-class ConstantMedium : public Object {
+class ConstantMedium : public Object, public Medium {
 public:
     /**
      * @brief Construct a new Constant Medium.
@@ -25,80 +28,73 @@ public:
      * @param a The texture/color of the medium.
      */
     ConstantMedium(std::shared_ptr<Object> b, float d, std::shared_ptr<Texture> a)
-        : boundary(b), neg_inv_density(-1.0f / d), phase_function(std::make_shared<Isotropic>(a)) {}
+        : boundary(b), density(d), phase_function(std::make_shared<Isotropic>(a)) { boundary_interface.inside = this; }
 
     /**
      * @brief Overload using color directly.
      */
     ConstantMedium(std::shared_ptr<Object> b, float d, glm::vec3 c)
-        : boundary(b), neg_inv_density(-1.0f / d), phase_function(std::make_shared<Isotropic>(c)) {}
+        : boundary(b), density(d), phase_function(std::make_shared<Isotropic>(c)) { boundary_interface.inside = this; }
 
     /**
      * @brief Construct a Glowing Volume.
      * @param emit_color The color/intensity of the light emitted by the smoke.
      */
     ConstantMedium(std::shared_ptr<Object> b, float d, glm::vec3 color, glm::vec3 emit_color)
-        : boundary(b), neg_inv_density(-1.0f / d), 
-          phase_function(std::make_shared<Isotropic>(color, emit_color)) {}
+        : boundary(b), density(d), 
+          phase_function(std::make_shared<Isotropic>(color, emit_color)) { boundary_interface.inside = this; }
           
     /**
      * @brief Construct a Glowing Volume (Texture based).
      */
     ConstantMedium(std::shared_ptr<Object> b, float d, std::shared_ptr<Texture> a, std::shared_ptr<Texture> emit_tex)
-        : boundary(b), neg_inv_density(-1.0f / d), 
-          phase_function(std::make_shared<Isotropic>(a, emit_tex)) {}
+        : boundary(b), density(d), 
+          phase_function(std::make_shared<Isotropic>(a, emit_tex)) { boundary_interface.inside = this; }
 
 
+    /**
+     * @brief Hit on the boundary only: no material, the ray crosses into get_medium_interface().
+     */
     virtual bool intersect(const Ray& r, float t_min, float t_max, HitRecord& rec) const override {
-        // Print occasional debug info locally if needed, but keep clean for perf
-        
-        HitRecord rec1, rec2;
-
-        // 1. Find the entry point (allow t_min to be -Infinity to catch containment)
-        if (!boundary->intersect(r, -Infinity, Infinity, rec1))
-            return false;
-
-        // 2. Find the exit point (must be after entry)
-        if (!boundary->intersect(r, rec1.t + SHADOW_EPSILON, Infinity, rec2))
-            return false;
-
-        // 3. Process edge cases (clamping)
-        if (rec1.t < t_min) rec1.t = t_min;
-        if (rec2.t > t_max) rec2.t = t_max;
-
-        if (rec1.t >= rec2.t)
-            return false;
-
-        if (rec1.t < 0)
-            rec1.t = 0;
+        if (!boundary->intersect(r, t_min, t_max, rec)) return false;
+        rec.mat_ptr = nullptr;
+        rec.object = this;
+        return true;
+    }
 
-        // 4. Calculate distance through the medium
-        const float ray_length = glm::length(r.direction());
-        const float distance_inside_boundary = (rec2.t - rec1.t) * ray_length;
+    virtual const MediumInterface* get_medium_interface() const override { return &boundary_interface; }
 
-        // 5. Sample a random distance based on density
-        // hit_distance = - (1/density) * log(random)
-        const float hit_distance = neg_inv_density * log(random_float());
+    virtual void finish_loading() override { boundary->finish_loading(); }
 
-        // 6. Determine if the ray scattered inside
-        if (hit_distance > distance_inside_boundary)
-            return false; // Ray passed through the smoke without hitting a particle
+    /**
+     * @brief Exponential free flight: distance = -ln(xi) / density.
+     * The scattering probability cancels the transmittance, so the weight is always 1.
+     */
+    virtual bool sample(const Ray& r, float t_max, HitRecord& rec, glm::vec3& weight) const override {
+        weight = glm::vec3(1.0f);
+        const float hit_distance = -std::log(random_float()) / density;
+        if (hit_distance >= t_max) return false;
 
-        // 7. Record the hit details
-        rec.t = rec1.t + hit_distance / ray_length;
+        rec.t = hit_distance;
         rec.p = r.at(rec.t);
 
         // Volumetric scattering is isotropic, normal is arbitrary.
         // We set it to (1,0,0) and front_face to true essentially ignoring it in Isotropic::scatter
         rec.normal = glm::vec3(1, 0, 0); 
         rec.front_face = true; 
+        rec.u = rec.v = 0.0f;
+        rec.uv_scale = 0.0f;
+        rec.prim_id = -1;
         
         rec.mat_ptr = phase_function.get();
         rec.object = this;
-
         return true;
     }
 
+    virtual glm::vec3 transmittance(const Ray& r, float t_max) const override {
+        return glm::vec3(std::exp(-density * t_max));
+    }
+
     virtual bool bounding_box(float time0, float time1, AABB& output_box) const override {
         return boundary->bounding_box(time0, time1, output_box);
     }
@@ -111,15 +107,23 @@ public:
     virtual glm::vec3 random_pointing_vector(const glm::vec3& origin) const override {
         return boundary->random_pointing_vector(origin);
     }
+
+    virtual glm::vec3 random_pointing_vector(const glm::vec3& origin, float& pdf) const override {
+        return boundary->random_pointing_vector(origin, pdf);
+    }
     
     virtual void sample_surface(glm::vec3& pos, glm::vec3& normal, float& area) const override {
         boundary->sample_surface(pos, normal, area);
     }
 
     virtual Material* get_material() const override { return phase_function.get(); }
+    virtual Material* get_phase_function() const override { return phase_function.get(); }
 
 public:
     std::shared_ptr<Object> boundary;
+    float density;
     std::shared_ptr<Material> phase_function;
-    float neg_inv_density;
+
+private:
+    MediumInterface boundary_interface;
 };
\ No newline at end of file
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "path_integrator.hpp"
+#include "photon_integrator.hpp"
+#include <iostream>
+#include <memory>
+#include <utility>
+
+/**
+ * @brief Instantiate Impl<Features> for the runtime mask 'features' (one specialization per mask value).
+ */
+template <template <unsigned> class Impl, unsigned Features = 0, typename... Args>
+std::unique_ptr<Integrator> instantiate_integrator(unsigned features, Args&&... args) {
+    if constexpr (Features > FEATURE_ALL) {
+        return nullptr;
+    } else {
+        if (features == Features) return std::make_unique<Impl<Features>>(std::forward<Args>(args)...);
+        return instantiate_integrator<Impl, Features + 1>(features, std::forward<Args>(args)...);
+    }
+}
+
+/**
+ * @brief Parameters of make_integrator(); the photon fields are ignored by the path tracer.
+ */
+struct IntegratorSettings {
+    bool use_photon_mapping = false;
+    int max_depth = 50;
+    int num_photons = 0;
+    float caustic_radius = 0.0f;
+    float global_radius = 0.0f;
+    float volume_radius = 0.0f;  // Maximum volume photon radius, 0 disables the beam estimate
+    int k_nearest = 0;
+    int final_gather_bound = 0;
+    float time0 = 0.0f;  // Shutter open
+    float time1 = 1.0f;  // Shutter close
+};
+
+/**
+ * @brief Inspect the scene once and build the integrator specialized on the features it uses.
+ * The scene must be complete (objects, lights and environment) before this is called.
+ */
+inline std::unique_ptr<Integrator> make_integrator(const IntegratorSettings& settings, const Scene& scene) {
+    unsigned features = scene_features(scene, settings.time0, settings.time1);
+    std::cout << "[Integrator] Features:"
+              << ((features & FEATURE_MOTION_BLUR) ? " motion-blur" : "")
+              << ((features & FEATURE_SPECTRAL) ? " spectral" : "")
+              << ((features & FEATURE_MEDIA) ? " media" : "")
+              << ((features & FEATURE_ENV_LIGHT) ? " env-light" : "")
+              << (features == 0 ? " none" : "") << std::endl;
+
+    if (settings.use_photon_mapping) {
+        std::cout << "Using Photon Integrator..." << std::endl;
+        return instantiate_integrator<PhotonIntegrator>(
+            features,
+            settings.max_depth,
+            settings.num_photons,
+            settings.caustic_radius,
+            settings.global_radius,
+            settings.volume_radius,
+            settings.k_nearest,
+            settings.final_gather_bound,
+            settings.time0, settings.time1, scene
+        );
+    }
+    std::cout << "Using Path Integrator (MIS + NEE)..." << std::endl;
+    return instantiate_integrator<PathIntegrator>(features, settings.max_depth, scene);
+}
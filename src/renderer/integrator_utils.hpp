@@ -2,11 +2,47 @@
 
 #include "../scene/scene.hpp"
 #include "../scene/camera.hpp"
-#include "../material/material_utils.hpp"
+#include "../material/material_dispatch.hpp"
 #include "../core/distribution.hpp"
 #include "../core/utils.hpp"
 #include <glm/glm.hpp>
 
+/**
+ * @brief Scene features an integrator can be specialized on (bit mask template parameter).
+ * A cleared bit compiles the corresponding per-bounce work out of the integrator loop.
+ */
+enum IntegratorFeature : unsigned {
+    FEATURE_MOTION_BLUR = 1u << 0, // Some object moves during the shutter: rays carry their time
+    FEATURE_SPECTRAL    = 1u << 1, // Dispersive materials: rays carry a wavelength
+    FEATURE_MEDIA       = 1u << 2, // Participating media: isotropic phase lobes in the BSDF closure
+    FEATURE_ENV_LIGHT   = 1u << 3, // Environment light: miss shading and light selection include it
+    FEATURE_ALL         = (1u << 4) - 1
+};
+
+/**
+ * @brief Inspect the scene once and return the features it actually uses.
+ * Unknown (MaterialKind::Other) materials conservatively enable every material-dependent feature.
+ */
+inline unsigned scene_features(const Scene& scene, float time0, float time1) {
+    unsigned features = 0;
+    if (scene.env_light) features |= FEATURE_ENV_LIGHT;
+
+    for (const auto& obj : scene.objects) {
+        // Moving objects are the ones whose bounds differ between shutter open and close
+        AABB box0, box1;
+        if (obj->bounding_box(time0, time0, box0) && obj->bounding_box(time1, time1, box1) &&
+            (box0.min_point() != box1.min_point() || box0.max_point() != box1.max_point()))
+            features |= FEATURE_MOTION_BLUR;
+
+        obj->for_each_material([&](const Material& mat) {
+            if (mat.kind == MaterialKind::DispersiveGlass) features |= FEATURE_SPECTRAL;
+            if (mat.kind == MaterialKind::Isotropic) features |= FEATURE_MEDIA;
+            if (mat.kind == MaterialKind::Other) features |= FEATURE_SPECTRAL | FEATURE_MEDIA;
+        });
+    }
+    return features;
+}
+
 /**
  * @brief Abstract base class for rendering algorithms.
  */
@@ -19,6 +55,14 @@ public:
      */
     virtual glm::vec3 estimate_radiance(const Ray& r, const Scene& scene) const = 0;
 
+    /**
+     * @brief Redo only the work invalidated by scene edits (see Scene::commit_changes()).
+     * Light selection depends on the emitted powers alone, so it is rebuilt only when they changed.
+     */
+    virtual void update(const Scene& scene, const SceneChanges& changes) {
+        if (changes.lights) preprocess(scene);
+    }
+
 protected:
     std::unique_ptr<Distribution1D> light_distribution;
 
@@ -63,17 +107,92 @@ protected:
         return;
     }
 
+    /**
+     * @brief Copy of 'r' for a secondary ray from 'origin': time and wavelength are only carried
+     * when the scene needs them, so the default values stay compile-time constants otherwise.
+     */
+    template <unsigned Features>
+    static Ray spawn_ray(const glm::vec3& origin, const glm::vec3& direction, const Ray& r) {
+        Ray spawned(origin, direction,
+                    (Features & FEATURE_MOTION_BLUR) ? r.time() : 0.0f,
+                    (Features & FEATURE_SPECTRAL) ? r.get_wavelength() : 0.0f);
+        if (Features & FEATURE_MEDIA) spawned.medium = r.medium; // Surfaces with a material keep the medium
+        return spawned;
+    }
+
+    /**
+     * @brief Default segment hook of next_interaction(): every medium segment is free-flight sampled.
+     * A hook whose free_flight() returns false for a medium takes over its segments instead: after the
+     * surface query it is called with the segment and where it ends, and attenuates the weight itself.
+     */
+    struct FreeFlightSegments {
+        bool free_flight(const Medium*) const { return true; }
+        void operator()(const Ray&, float, glm::vec3&) const {}
+    };
+
+    /**
+     * @brief Next interaction along 'r': the closest surface with a material or, inside a medium,
+     * a scattering event before it. Medium boundaries on the way are crossed and 'r.medium' is
+     * switched; the origin of 'r' is kept, so rec.t and light PDFs still refer to it.
+     *
+     * @param weight Multiplied by the free-flight weights of the media traversed.
+     * @param hook Per-segment hook (see FreeFlightSegments).
+     * @return false if the ray leaves the scene.
+     */
+    template <unsigned Features, typename SegmentHook = FreeFlightSegments>
+    static bool next_interaction(const Scene& scene, Ray& r, HitRecord& rec, glm::vec3& weight,
+                                 const SegmentHook& hook = SegmentHook()) {
+        if (!(Features & FEATURE_MEDIA)) return scene.intersect(r, SHADOW_EPSILON, Infinity, rec);
+
+        Ray segment = r;
+        float t_offset = 0.0f; // Distance from the origin of 'r' to the origin of 'segment'
+        for (int crossing = 0; crossing <= MEDIUM_MAX_CROSSINGS; ++crossing) {
+            // Free flight first: the surface query only has to look up to the sampled distance
+            const bool free_flight = segment.medium && hook.free_flight(segment.medium);
+            HitRecord event;
+            bool scattered = false;
+            if (free_flight) {
+                glm::vec3 flight_weight;
+                scattered = segment.medium->sample(segment, Infinity, event, flight_weight);
+                weight *= flight_weight;
+            }
+            bool hit = scene.intersect(segment, SHADOW_EPSILON, scattered ? event.t : Infinity, rec);
+            if (segment.medium && !free_flight) hook(segment, hit ? rec.t : Infinity, weight);
+            if (scattered && !hit) {
+                rec = event;
+                rec.t += t_offset;
+                r.medium = segment.medium;
+                return true;
+            }
+            if (!hit || rec.mat_ptr) {
+                rec.t += t_offset;
+                r.medium = segment.medium;
+                return hit;
+            }
+
+            // Medium boundary: continue behind it, in the medium on the other side
+            const Medium* next = medium_after(*rec.object->get_medium_interface(), rec, segment.direction());
+            segment = Ray(rec.p, segment.direction(), segment.time(), segment.get_wavelength());
+            segment.medium = next;
+            t_offset += rec.t;
+        }
+        return false;
+    }
+
     /**
      * @brief Samples a random light source for direct lighting (Next Event Estimation).
      * Exposed for use in PhotonIntegrator.
      * 
+     * @tparam Features IntegratorFeature mask of the calling integrator.
      * @param scene The scene reference.
      * @param rec The hit record of the current surface point.
      * @param srec The scatter record (contains material info).
      * @param time The time of the ray (for motion blur).
      * @return glm::vec3 The UNWEIGHTED direct radiance (not multiplied by path throughput yet).
      */
+    template <unsigned Features>
     glm::vec3 sample_one_light(const Scene& scene, const HitRecord& rec, const ScatterRecord& srec, const Ray& current_ray, const bool local_light_caustic) const {
+        constexpr bool volumes = (Features & FEATURE_MEDIA) != 0;
         if (!light_distribution || light_distribution->count() == 0) return glm::vec3(0.0f);
         // 1. Sample a light source based on its power
         float light_select_pdf;
@@ -85,7 +204,7 @@ protected:
         bool caustic = local_light_caustic;
 
         // Determine which light was picked (Scene Lights vs Env Light)
-        if (light_idx < static_cast<int>(n_scene_lights)) {
+        if (!(Features & FEATURE_ENV_LIGHT) || light_idx < static_cast<int>(n_scene_lights)) {
             light = scene.lights[light_idx].get();
         } else {
             light = scene.env_light.get();
@@ -100,9 +219,9 @@ protected:
 
         if (light_pdf <= EPSILON || near_zero(L_emitted)) return glm::vec3(0.0f);
 
-        Ray shadow_ray(rec.p, to_light, current_ray.time(), current_ray.get_wavelength());
+        Ray shadow_ray = spawn_ray<Features>(rec.p, to_light, current_ray);
         
-        glm::vec3 f_r = rec.mat_ptr->eval(current_ray, rec, shadow_ray, srec.shading_normal);
+        glm::vec3 f_r = srec.bsdf.eval<volumes>(to_light);
         
         if (near_zero(f_r)) return glm::vec3(0.0f);
         
@@ -116,7 +235,7 @@ protected:
         if (near_zero(visibility)) return glm::vec3(0.0f); // In shadow
 
         // Calculate BSDF PDF for this NEE direction
-        float bsdf_pdf = rec.mat_ptr->scattering_pdf(current_ray, rec, shadow_ray, srec.shading_normal);
+        float bsdf_pdf = srec.bsdf.pdf<volumes>(to_light);
         
         float total_light_pdf = light_select_pdf * light_pdf;
 
@@ -128,7 +247,11 @@ protected:
     /**
      * @brief Handle ray missing geometry (Environment lookup + MIS).
      */
+    template <unsigned Features>
     glm::vec3 eval_environment(const Scene& scene, const Ray& r, float bsdf_pdf, bool is_specular) const {
+        // Without an environment light the background is black
+        if (!(Features & FEATURE_ENV_LIGHT)) return glm::vec3(0.0f);
+
         glm::vec3 env_color = scene.sample_background(r);
         
         // If pure specular bounce or no lights, take full contribution
@@ -151,11 +274,29 @@ protected:
         return env_color * weight;
     }
 
+    /**
+     * @brief Project the ray cone onto the hit surface to get the texture footprint in UV units.
+     */
+    void set_texture_footprint(const Ray& r, HitRecord& rec) const {
+        float width = r.cone_width + r.cone_spread * rec.t;
+        float cosine = std::max(std::abs(glm::dot(r.direction(), rec.normal)), RAY_CONE_MIN_COSINE);
+        rec.uv_width = width * rec.uv_scale / cosine;
+    }
+
+    /**
+     * @brief Carry the ray cone over to the scattered ray.
+     * Specular bounces keep the spread (surfaces treated as locally flat); other bounces widen it.
+     */
+    void propagate_ray_cone(const Ray& r_in, const HitRecord& rec, ScatterRecord& srec) const {
+        srec.specular_ray.cone_width = r_in.cone_width + r_in.cone_spread * rec.t;
+        srec.specular_ray.cone_spread = r_in.cone_spread + (srec.is_specular ? 0.0f : RAY_CONE_DIFFUSE_SPREAD);
+    }
+
     /**
      * @brief Handle ray hitting a light source directly (Emission + MIS).
      */
     glm::vec3 eval_emission(const Scene& scene, const HitRecord& rec, const Ray& r, float bsdf_pdf, bool is_specular) const {
-        glm::vec3 emitted = rec.mat_ptr->emitted(rec.u, rec.v, rec.p);
+        glm::vec3 emitted = material_emitted(*rec.mat_ptr, rec.u, rec.v, rec.p);
         
         // If pure specular or no light sampling setup, return full emission
         if (is_specular || !light_distribution) {
@@ -172,7 +313,9 @@ protected:
         if (light_idx < 0) return emitted;
 
         float light_select_pdf = light_distribution->pdf_discrete(light_idx);
-        float area_pdf = rec.object->pdf_value(r.origin(), r.direction()); // Solid Angle PDF
+        // Ask the registered light: for meshes it also accounts for the selection probability of
+        // the hit triangle (rec.prim_id). The hit is already known, so the PDF is analytic.
+        float area_pdf = scene.lights[light_idx]->pdf_value(r.origin(), r.direction(), rec); // Solid Angle PDF
         float total_light_pdf = light_select_pdf * area_pdf;
 
         float weight = power_heuristic(bsdf_pdf, total_light_pdf);
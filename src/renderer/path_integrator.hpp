@@ -3,12 +3,15 @@
 
 /**
  * @brief Path Tracer with Multiple Importance Sampling (MIS).
+ * @tparam Features IntegratorFeature mask; use make_integrator() to pick the one matching the scene.
  */
+template <unsigned Features = FEATURE_ALL>
 class PathIntegrator : public Integrator {
 public:
     PathIntegrator(int max_d, const Scene& scene) : max_depth(max_d) {preprocess(scene);}
 
     glm::vec3 estimate_radiance(const Ray& start_ray, const Scene& scene) const {
+        constexpr bool volumes = (Features & FEATURE_MEDIA) != 0;
         Ray current_ray = start_ray;
         glm::vec3 L(0.0f);           
         glm::vec3 throughput(1.0f); 
@@ -20,15 +23,16 @@ public:
             HitRecord rec;
             
             // 1. Intersection
-            if (!scene.intersect(current_ray, SHADOW_EPSILON, Infinity, rec)) {
-                glm::vec3 env_L = throughput * eval_environment(scene, current_ray, last_bsdf_pdf, last_bounce_specular);
+            if (!next_interaction<Features>(scene, current_ray, rec, throughput)) {
+                glm::vec3 env_L = throughput * eval_environment<Features>(scene, current_ray, last_bsdf_pdf, last_bounce_specular);
                 if (bounce > 0) clamp_radiance(env_L);
                 L += env_L;
                 break;
             }
+            set_texture_footprint(current_ray, rec);
 
             // 2. Emission (Hit Light via BSDF sampling)
-            if (rec.mat_ptr->is_emissive()) {
+            if (material_is_emissive(*rec.mat_ptr)) {
                 glm::vec3 e = throughput * eval_emission(scene, rec, current_ray, last_bsdf_pdf, last_bounce_specular);
                 if (bounce > 0) clamp_radiance(e);
                 L += e;
@@ -37,11 +41,13 @@ public:
 
             // 3. Material Sampling
             ScatterRecord srec(rec.normal);
-            if (!rec.mat_ptr->scatter(current_ray, rec, srec)) break;
+            if (!material_scatter(*rec.mat_ptr, current_ray, rec, srec)) break;
+            propagate_ray_cone(current_ray, rec, srec);
+            if (Features & FEATURE_MEDIA) srec.specular_ray.medium = current_ray.medium;
 
             // 4. Direct Lighting via NEE (if not specular)
             if (!srec.is_specular) {
-                glm::vec3 e = throughput * sample_one_light(scene, rec, srec, current_ray, true); // need all lights
+                glm::vec3 e = throughput * sample_one_light<Features>(scene, rec, srec, current_ray, true); // need all lights
                 clamp_radiance(e);
                 L += e;
             }
@@ -52,7 +58,7 @@ public:
                 last_bsdf_pdf = 1.0f; // Dirac distribution, arbitrary placeholder
             } else {
                 float cos_theta = std::abs(glm::dot(srec.shading_normal, srec.specular_ray.direction()));
-                throughput *= rec.mat_ptr->eval(current_ray, rec, srec.specular_ray, srec.shading_normal) * cos_theta / srec.pdf;
+                throughput *= srec.bsdf.eval<volumes>(srec.specular_ray.direction()) * cos_theta / srec.pdf;
                 last_bsdf_pdf = srec.pdf; 
             }
             
@@ -2,6 +2,7 @@
 
 #include "integrator_utils.hpp"
 #include "../accel/kdtree.hpp"
+#include "../accel/volume_photon_map.hpp"
 #include "../core/photon.hpp"
 #include "../core/onb.hpp"
 #include <omp.h>
@@ -9,6 +10,7 @@
 #include <vector>
 #include <mutex>
 #include <algorithm>
+#include <unordered_set>
 
 /**
  * @brief Integrator implementing Photon Mapping with MIS-based Direct Lighting.
@@ -19,6 +21,11 @@
  * 3. Indirect Diffuse (L -> ... -> D -> D): 
  *    - Early bounces: Path Tracing recursion.
  *    - Late bounces: Global Map lookup (Final Gather).
+ * 4. Glossy surfaces (rough metal) are never looked up in the maps (a density estimate would
+ *    blur the highlight): they get NEE + MIS and are path traced, and photons pass through them.
+ * 5. In-scattering in media (L -> ... -> V): Photons scattering in a non-emissive medium go to the
+ *    Volume Map only. Camera rays do not scatter in such media: every segment through them gathers
+ *    a Beam Radiance Estimate over its whole length and is attenuated by its transmittance.
  * 
  * "Sticky Flag" Strategy:
  * To strictly prevent double counting between the Caustic Map and Path Tracing:
@@ -27,7 +34,10 @@
  * - If a ray with this flag hits a Local Light, the contribution is DISCARDED (because the 
  *   energy was already retrieved from the Caustic Map at the Diffuse origin).
  * - Environment lights remain valid as they are not in the photon map.
+ *
+ * @tparam Features IntegratorFeature mask; use make_integrator() to pick the one matching the scene.
  */
+template <unsigned Features = FEATURE_ALL>
 class PhotonIntegrator : public Integrator {
 public:
     /**
@@ -35,25 +45,46 @@ public:
      * @param n_photons Number of photons to emit globally.
      * @param caustic_r Radius to search for caustic photons.
      * @param global_r Radius to search for global indirect photons.
+     * @param volume_r Maximum radius of a volume photon (0 disables the volume map).
+     * @param k Neighbours used by the surface estimates and to size the volume photons.
      * @param f_gather_bound Depth at which to switch from PT recursion to Global Map lookup.
      * @param t0 Shutter open time.
      * @param t1 Shutter close time.
      * @param scene The scene reference.
      */
     PhotonIntegrator(int max_d, int n_photons,
-                     float caustic_r, float global_r, int k,
+                     float caustic_r, float global_r, float volume_r, int k,
                      int f_gather_bound,
                      float t0, float t1,
                      const Scene& scene)
-        : max_depth(max_d), num_photons_global(n_photons), 
-          gather_radius_caustic(caustic_r), gather_radius_global(global_r), 
-          K(k),
-          final_gather_bound(f_gather_bound),
-          shutter_open(t0), shutter_close(t1) {
+        : max_depth(max_d), final_gather_bound(f_gather_bound),
+          num_photons_global(n_photons), K(k),
+          shutter_open(t0), shutter_close(t1),
+          gather_radius_global(global_r), gather_radius_caustic(caustic_r), gather_radius_volume(volume_r) {
             preprocess(scene);
             build_photon_map(scene);
         }
 
+    /**
+     * @brief Re-emit the photons only if the edits can change where they land or what they carry:
+     * moved geometry, changed emission, or an edited material that some photon interacted with.
+     */
+    void update(const Scene& scene, const SceneChanges& changes) override {
+        Integrator::update(scene, changes);
+        bool stale = changes.geometry() || changes.lights;
+        for (const Material* mat : changes.materials) stale = stale || photon_materials.count(mat) > 0;
+        if (!stale) {
+            std::cout << "[PhotonIntegrator] Edits not seen by photons, maps reused." << std::endl;
+            return;
+        }
+
+        caustic_map = PhotonMap();
+        global_map = PhotonMap();
+        volume_map = VolumePhotonMap();
+        photon_materials.clear();
+        build_photon_map(scene);
+    }
+
     /**
      * @brief Phase 1: Emit photons and build the KD-Trees.
      */
@@ -108,6 +139,7 @@ public:
         // Thread-safe temporary storage
         std::vector<Photon> master_caustic_list;
         std::vector<Photon> master_global_list;
+        std::vector<Photon> master_volume_list;
         std::mutex list_mutex;
 
         std::atomic<long long> emitted_counter{0};
@@ -118,6 +150,8 @@ public:
         {
             std::vector<Photon> local_caustic;
             std::vector<Photon> local_global;
+            std::vector<Photon> local_volume;
+            std::unordered_set<const Material*> local_materials;
             
             auto update_progress = [&]() {
                 long long current = ++emitted_counter;
@@ -144,13 +178,13 @@ public:
 
                 for (int k = 0; k < n_global; ++k) {
                     update_progress();
-                    float time = shutter_open + random_float() * (shutter_close - shutter_open);
+                    float time = shutter_time();
                     glm::vec3 pos, dir, power;
                     light->emit(pos, dir, power, static_cast<float>(n_total)); 
 
                     if (glm::length(power) > 0.0f) {
                         Ray photon_ray(pos + dir * SHADOW_EPSILON, dir, time); 
-                        trace_photon(scene, photon_ray, power, local_caustic, local_global);
+                        trace_photon(scene, photon_ray, power, local_caustic, local_global, local_volume, local_materials);
                     }
                 }
 
@@ -160,21 +194,26 @@ public:
                         for (int k = 0; k < per_target; ++k) {
                             update_progress();
                             glm::vec3 pos, dir, power;
-                            float time = shutter_open + random_float() * (shutter_close - shutter_open);
+                            float time = shutter_time();
                             if (light->emit_targeted(pos, dir, power, (float)n_total, *target)
                                 && glm::length(power) > 0.0f) {
                                     Ray photon_ray(pos + dir * SHADOW_EPSILON, dir, time); 
-                                    trace_photon(scene, photon_ray, power, local_caustic, local_global);
+                                    trace_photon(scene, photon_ray, power, local_caustic, local_global, local_volume, local_materials);
                                 }
                         }
                     }
                 }
             }
 
-            if (!local_caustic.empty() || !local_global.empty()) {
+            if (!local_caustic.empty() || !local_global.empty() || !local_volume.empty()) {
                 std::lock_guard<std::mutex> lock(list_mutex);
                 master_caustic_list.insert(master_caustic_list.end(), local_caustic.begin(), local_caustic.end());
                 master_global_list.insert(master_global_list.end(), local_global.begin(), local_global.end());
+                master_volume_list.insert(master_volume_list.end(), local_volume.begin(), local_volume.end());
+            }
+            if (!local_materials.empty()) {
+                std::lock_guard<std::mutex> lock(list_mutex);
+                photon_materials.insert(local_materials.begin(), local_materials.end());
             }
         }
         std::cout << std::endl; 
@@ -187,6 +226,12 @@ public:
 
         global_map.build();
         caustic_map.build();
+
+        if (!master_volume_list.empty()) {
+            std::cout << "[PhotonIntegrator] Building volume photon map... (" << master_volume_list.size() << ")" << std::endl;
+            for (const auto& p : master_volume_list) volume_map.add_photon(p);
+            volume_map.build(K, gather_radius_volume);
+        }
     }
 
     /**
@@ -194,12 +239,14 @@ public:
      * Implements "Sticky Flag" logic to handle L-S-D paths correctly.
      */
     virtual glm::vec3 estimate_radiance(const Ray& start_ray, const Scene& scene) const override {
+        constexpr bool volumes = (Features & FEATURE_MEDIA) != 0;
         glm::vec3 L(0.0f);
         glm::vec3 throughput(1.0f);
         Ray current_ray = start_ray;
         
         // Initial State
         bool last_bounce_specular = true; // Treats primary ray as specular for MIS
+        bool last_bounce_diffuse = false; // Only diffuse hits gather caustics, so only they open a caustic path
         bool in_caustic_path = false;     // "Sticky Flag": Once true, stays true.
         float last_bsdf_pdf = 0.0f;
 
@@ -209,19 +256,20 @@ public:
             // -----------------------------------------------------------------
             // 1. Intersection & Environment
             // -----------------------------------------------------------------
-            if (!scene.intersect(current_ray, SHADOW_EPSILON, Infinity, rec)) {
+            if (!next_interaction<Features>(scene, current_ray, rec, throughput, BeamSegments{*this, L, !in_caustic_path})) {
                 // Environment light is NOT in the photon map.
                 // Always evaluate it, regardless of in_caustic_path state.
-                glm::vec3 env_L = throughput * eval_environment(scene, current_ray, last_bsdf_pdf, last_bounce_specular);
+                glm::vec3 env_L = throughput * eval_environment<Features>(scene, current_ray, last_bsdf_pdf, last_bounce_specular);
                 if (bounce > 0) clamp_radiance(env_L);
                 L += env_L;
                 break;
             }
+            set_texture_footprint(current_ray, rec);
 
             // -----------------------------------------------------------------
             // 2. Emission (Hit Local Light)
             // -----------------------------------------------------------------
-            if (rec.mat_ptr->is_emissive()) {
+            if (material_is_emissive(*rec.mat_ptr)) {
                 if (in_caustic_path) {
                     // [DISCARD] 
                     // We are in a path: Diffuse_Origin -> Specular -> ... -> Light.
@@ -243,7 +291,9 @@ public:
             // 3. Material Scatter
             // -----------------------------------------------------------------
             ScatterRecord srec(rec.normal);
-            if (!rec.mat_ptr->scatter(current_ray, rec, srec)) break;
+            if (!material_scatter(*rec.mat_ptr, current_ray, rec, srec)) break;
+            propagate_ray_cone(current_ray, rec, srec);
+            if (Features & FEATURE_MEDIA) srec.specular_ray.medium = current_ray.medium;
 
             // -----------------------------------------------------------------
             // 4. Handle Logic based on Material Type
@@ -254,7 +304,7 @@ public:
                 // [Update Sticky Flag]
                 // If we transition from Diffuse to Specular, we enter the "Caustic Zone".
                 // If we were already in it (S -> S), we stay in it.
-                if (!last_bounce_specular) {
+                if (last_bounce_diffuse) {
                     in_caustic_path = true;
                 }
                 
@@ -262,8 +312,28 @@ public:
                 throughput *= srec.attenuation;
                 current_ray = srec.specular_ray;
                 last_bounce_specular = true;
+                last_bounce_diffuse = false;
                 last_bsdf_pdf = 1.0f; // Dirac delta PDF
             }
+            else if (srec.bsdf.lobe == BsdfClosure::Lobe::Glossy) {
+                // === GLOSSY BOUNCE (Rough Metal) ===
+                // Direct light by NEE, unless this branch is a caustic path (then the light it
+                // would find was already counted by the caustic map at the diffuse origin).
+                if (!in_caustic_path) {
+                    glm::vec3 L_direct = sample_one_light<Features>(scene, rec, srec, current_ray, false);
+                    clamp_radiance(L_direct);
+                    L += throughput * L_direct;
+                }
+
+                float cos_theta = std::abs(glm::dot(srec.shading_normal, srec.specular_ray.direction()));
+                if (srec.pdf <= EPSILON) break;
+
+                throughput *= srec.bsdf.eval<volumes>(srec.specular_ray.direction()) * cos_theta / srec.pdf;
+                current_ray = srec.specular_ray;
+                last_bounce_specular = false;
+                last_bounce_diffuse = false;
+                last_bsdf_pdf = srec.pdf;
+            }
             else {
                 // === DIFFUSE BOUNCE ===
                 
@@ -280,11 +350,12 @@ public:
                     float cos_theta = std::abs(glm::dot(srec.shading_normal, srec.specular_ray.direction()));
                     if (srec.pdf <= EPSILON) break;
 
-                    glm::vec3 f_r = rec.mat_ptr->eval(current_ray, rec, srec.specular_ray, srec.shading_normal);
+                    glm::vec3 f_r = srec.bsdf.eval<volumes>(srec.specular_ray.direction());
                     throughput *= (f_r * cos_theta / srec.pdf);
                     
                     current_ray = srec.specular_ray;
                     last_bounce_specular = false;
+                    last_bounce_diffuse = true;
                     last_bsdf_pdf = srec.pdf;
                     // in_caustic_path remains TRUE (Sticky)
                 } 
@@ -294,7 +365,7 @@ public:
                     // We collect all incoming energy here.
 
                     // 1. Direct Light (NEE) - Handles L -> D
-                    glm::vec3 L_direct = sample_one_light(scene, rec, srec, current_ray, false); // ignore normal light caustic
+                    glm::vec3 L_direct = sample_one_light<Features>(scene, rec, srec, current_ray, false); // ignore normal light caustic
                     clamp_radiance(L_direct);
                     L += throughput * L_direct;
 
@@ -316,11 +387,12 @@ public:
                         float cos_theta = std::abs(glm::dot(srec.shading_normal, srec.specular_ray.direction()));
                         if (srec.pdf <= EPSILON) break;
 
-                        glm::vec3 f_r = rec.mat_ptr->eval(current_ray, rec, srec.specular_ray, srec.shading_normal);
+                        glm::vec3 f_r = srec.bsdf.eval<volumes>(srec.specular_ray.direction());
                         throughput *= (f_r * cos_theta / srec.pdf);
 
                         current_ray = srec.specular_ray;
                         last_bounce_specular = false; // Next hit will see this as Diffuse
+                        last_bounce_diffuse = true;
                         last_bsdf_pdf = srec.pdf;
                         // in_caustic_path remains FALSE
                     }
@@ -349,8 +421,19 @@ private:
     float shutter_close;
     float gather_radius_global;
     float gather_radius_caustic;
+    float gather_radius_volume;
     PhotonMap global_map;
     PhotonMap caustic_map;
+    VolumePhotonMap volume_map;
+    std::unordered_set<const Material*> photon_materials; // Every material a photon interacted with
+
+    /**
+     * @brief Emission time of a photon, only drawn when something in the scene moves.
+     */
+    float shutter_time() const {
+        if (!(Features & FEATURE_MOTION_BLUR)) return shutter_open;
+        return shutter_open + random_float() * (shutter_close - shutter_open);
+    }
 
     std::vector<const Object*> find_specular_targets(const Scene& scene) {
         std::vector<const Object*> targets;
@@ -368,22 +451,29 @@ private:
      * @brief Traces a photon.
      * Logic:
      * - Specular: Reflect/Refract, don't store.
+     * - Glossy: Continue with the sampled BSDF weight, don't store.
      * - Diffuse (via Specular): Store in Caustic Map.
      * - Diffuse (via Diffuse): Store in Global Map (if depth > 0 to exclude Direct Light).
+     * - Beam medium: Store in Volume Map (at any depth, it holds single scattering too).
+     * Every material met is added to 'local_materials' (edits to other materials keep the maps valid).
      */
     void trace_photon(const Scene& scene, Ray r, glm::vec3 power, 
                       std::vector<Photon>& local_caustic, 
-                      std::vector<Photon>& local_global) const {
+                      std::vector<Photon>& local_global,
+                      std::vector<Photon>& local_volume,
+                      std::unordered_set<const Material*>& local_materials) const {
         
         int depth = 0;
         bool prev_bounce_specular = false; // Emission is not specular
 
         while (depth < max_depth) {
             HitRecord rec;
-            if (!scene.intersect(r, SHADOW_EPSILON, Infinity, rec)) break;
+            if (!next_interaction<Features>(scene, r, rec, power)) break;
+            local_materials.insert(rec.mat_ptr);
 
             ScatterRecord srec(rec.normal);
-            if (!rec.mat_ptr->scatter(r, rec, srec)) break;
+            if (!material_scatter(*rec.mat_ptr, r, rec, srec)) break;
+            if (Features & FEATURE_MEDIA) srec.specular_ray.medium = r.medium;
 
             if (srec.is_specular) {
                 // Pass energy through specular
@@ -392,9 +482,28 @@ private:
                 depth++;
                 prev_bounce_specular = true;
             } 
+            else if (srec.bsdf.lobe == BsdfClosure::Lobe::Glossy) {
+                // Nothing is looked up on glossy surfaces, so nothing is stored; the photon keeps
+                // the diffuse-like history flag (L -> G -> D lands in the global map)
+                if (srec.pdf <= EPSILON) break;
+                glm::vec3 dir = srec.specular_ray.direction();
+                glm::vec3 weight = srec.bsdf.eval(dir) * std::abs(glm::dot(srec.shading_normal, dir)) / srec.pdf;
+
+                float q = std::clamp(std::max({weight.r, weight.g, weight.b}), 0.0f, 1.0f);
+                if (random_float() > q) break;
+
+                power *= weight / q;
+                r = srec.specular_ray;
+                depth++;
+                prev_bounce_specular = false;
+            }
             else {
-                // Hit Diffuse
-                if (prev_bounce_specular) {
+                // Hit Diffuse (or scattered in a medium)
+                if (srec.bsdf.lobe == BsdfClosure::Lobe::Isotropic && gathers_beams(r.medium)) {
+                    // Stored with the scattered power: the beam estimate only adds the phase function
+                    local_volume.push_back({rec.p, power * srec.attenuation, -glm::normalize(r.direction())});
+                }
+                else if (prev_bounce_specular) {
                     // Path: Light -> ... -> Specular -> Diffuse (Caustics)
                     local_caustic.push_back({rec.p, power, -glm::normalize(r.direction())});
                 } 
@@ -418,6 +527,51 @@ private:
         }
     }
 
+    /**
+     * @brief Whether camera rays in 'medium' use the beam estimate instead of scattering in it.
+     * Emissive media keep their scattering events, which is where their emission is collected.
+     */
+    bool gathers_beams(const Medium* medium) const {
+        if (!(Features & FEATURE_MEDIA) || gather_radius_volume <= 0.0f || !medium) return false;
+        return !material_is_emissive(*medium->get_phase_function());
+    }
+
+    /**
+     * @brief next_interaction() hook for camera rays: segments through beam media are not sampled but
+     * gather the Beam Radiance Estimate (added to L when 'gather') and are attenuated by their
+     * transmittance, so the returned interaction is a surface or an emissive medium event.
+     */
+    struct BeamSegments {
+        const PhotonIntegrator& integrator;
+        glm::vec3& L;
+        bool gather;
+
+        bool free_flight(const Medium* medium) const {
+            return integrator.volume_map.empty() || !integrator.gathers_beams(medium);
+        }
+
+        void operator()(const Ray& segment, float t_end, glm::vec3& throughput) const {
+            if (gather) {
+                glm::vec3 L_beam = integrator.estimate_beam_radiance(segment, t_end);
+                integrator.clamp_radiance(L_beam);
+                L += throughput * L_beam;
+            }
+            throughput *= segment.medium->transmittance(segment, t_end);
+        }
+    };
+
+    /**
+     * @brief Beam Radiance Estimate: in-scattered radiance along 'segment' over [0, t_end],
+     * sum of kernel * transmittance * phase * power over the volume photons the segment pierces.
+     */
+    glm::vec3 estimate_beam_radiance(const Ray& segment, float t_end) const {
+        glm::vec3 sum(0.0f);
+        volume_map.beam_query(segment, t_end, [&](const Photon& p, float t, float kernel) {
+            sum += p.power * (kernel * segment.medium->transmittance(segment, t));
+        });
+        return sum * INV_4PI; // Isotropic phase function
+    }
+
     /**
      * @brief Estimates radiance from map using kNN and Cone Filter.
      */
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "scene.hpp"
+#include "camera.hpp"
+#include "../object/mesh.hpp"
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Per-frame mesh and camera transforms for frame-sequence rendering.
+ *
+ * Tracks are functions of the sequence time t in [0, 1). Posing a frame transforms the animated
+ * meshes (vertices, then a bottom-up refit of their own BVH) and reports them to the scene, whose
+ * commit_changes() then rebuilds only the top level of the BVH: static meshes and the packed
+ * analytic shapes keep their hierarchies. A frame in which only the camera moves reports nothing,
+ * so photon maps are reused as they are.
+ */
+class Animation {
+public:
+    using MeshTrack = std::function<glm::mat4(float t)>;   // Transform on top of the mesh's loaded pose
+    using CameraTrack = std::function<Camera(float t)>;
+
+    void animate(std::shared_ptr<Mesh> mesh, MeshTrack track) {
+        mesh_tracks.push_back({std::move(mesh), std::move(track)});
+    }
+
+    void animate_camera(CameraTrack track) { camera_track = std::move(track); }
+
+    bool empty() const { return mesh_tracks.empty() && !camera_track; }
+
+    /**
+     * @brief Pose the scene and the camera for 'frame' out of 'frame_count'.
+     * Moved meshes are reported to 'scene'; the caller commits the changes.
+     */
+    void apply(int frame, int frame_count, Scene& scene, Camera& cam) const {
+        const float t = frame_count > 0 ? float(frame) / float(frame_count) : 0.0f;
+        if (camera_track) cam = camera_track(t);
+
+        for (const auto& track : mesh_tracks) {
+            track.mesh->set_transform(track.transform(t));
+            scene.object_changed(*track.mesh);
+        }
+    }
+
+private:
+    struct AnimatedMesh {
+        std::shared_ptr<Mesh> mesh;
+        MeshTrack transform;
+    };
+
+    std::vector<AnimatedMesh> mesh_tracks;
+    CameraTrack camera_track;
+};
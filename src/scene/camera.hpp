@@ -48,6 +48,15 @@ public:
         lower_left_corner = origin - horizontal / 2.0f - vertical / 2.0f - focus_dist * w;
 
         lens_radius = aperture / 2.0f;
+        tan_half_fov = h;
+    }
+
+    /**
+     * @brief Set the output image height, which defines the ray cone spread of one pixel.
+     * Until this is called, camera rays carry no cone and textures are sampled unfiltered.
+     */
+    void set_image_height(int image_height) {
+        pixel_spread = std::atan(2.0f * tan_half_fov / float(image_height));
     }
 
     /**
@@ -61,11 +70,25 @@ public:
         glm::vec3 rd = lens_radius * random_in_unit_disk();
         glm::vec3 offset = u * rd.x + v * rd.y;
 
-        return Ray(
+        Ray r(
             origin + offset,
             lower_left_corner + s * horizontal + t * vertical - origin - offset,
             random_float(time0, time1)
         );
+        r.cone_spread = pixel_spread;
+        return r;
+    }
+
+    /**
+     * @brief The same camera moved along its own axes (right, up, backwards), e.g. one eye of a stereo pair.
+     * The view direction and focus plane distance are kept, so shifted views stay parallel.
+     */
+    Camera shifted(float right, float up = 0.0f, float back = 0.0f) const {
+        Camera moved = *this;
+        const glm::vec3 offset = right * u + up * v + back * w;
+        moved.origin += offset;
+        moved.lower_left_corner += offset;
+        return moved;
     }
 
 private:
@@ -75,5 +98,7 @@ private:
     glm::vec3 vertical;
     glm::vec3 u, v, w;
     float lens_radius;
+    float tan_half_fov;
+    float pixel_spread = 0.0f; // Ray cone spread angle of one pixel
     float time0, time1; // Shutter open/close times
 };
\ No newline at end of file
@@ -2,10 +2,38 @@
 
 #include "../object/object_utils.hpp"
 #include "../texture/texture_utils.hpp"
+#include "../material/material_dispatch.hpp"
 #include "../light/light_agg.hpp"
+#include <algorithm>
+#include <functional>
 #include <vector>
 #include <memory>
+#include <string>
 #include "../accel/BVH.hpp"
+#include "../accel/primitive_set.hpp"
+#include "../core/task_graph.hpp"
+
+class Camera;
+class Scene;
+
+/**
+ * @brief Edits reported to a Scene since its last commit_changes(), so that every consumer only
+ * redoes the work they invalidate.
+ */
+struct SceneChanges {
+    std::vector<const Object*> moved;        // Objects whose geometry changed
+    std::vector<const Material*> materials;  // Materials whose parameters or textures changed
+    bool lights = false;                     // Emission changed: light powers and selection are stale
+
+    bool geometry() const { return !moved.empty(); }
+    bool empty() const { return moved.empty() && materials.empty() && !lights; }
+};
+
+/**
+ * @brief One edit of an interactive session: mutates the scene (or camera) and reports what it touched.
+ */
+using SceneEdit = std::function<void(Scene& world, Camera& cam)>;
+
 /**
  * @brief A container for all objects in the scene.
  * ~~Also implements the Object interface, so a Scene can be treated as a single Hittable.~~
@@ -19,14 +47,40 @@ public:
      * This enables Next Event Estimation (NEE) for the background.
      */
     void set_background(std::shared_ptr<Texture> bg) {
+        finish_environment();
         env_light = std::make_shared<EnvironmentLight>(bg);
     }
+
+    /**
+     * @brief Load an HDR environment map into the dedicated store and register it as the Environment Light.
+     * Preferred over set_background(ImageTexture) for large HDRIs: compact RGBE texels, no virtual texture
+     * lookups, and the sampling distribution is cached next to the file.
+     * Decoding and building the distribution run on the task graph; build_bvh() waits for them.
+     */
+    void set_environment(const std::string& filename, bool use_cdf_cache = true) {
+        finish_environment();
+        env_loading = TaskGraph::instance().submit([this, filename, use_cdf_cache] {
+            env_light = std::make_shared<EnvironmentLight>(std::make_shared<EnvironmentMap>(filename, use_cdf_cache));
+        });
+    }
+
+    /**
+     * @brief Wait for everything still loading in the background (meshes, environment map).
+     */
+    void finish_loading() {
+        for (const auto& object : objects) object->finish_loading();
+        finish_environment();
+    }
     /**
      * @brief Clear all objects and lights from the scene.
      */
     void clear() { 
+        finish_environment();
         objects.clear(); 
         lights.clear();
+        top_level.clear();
+        packed_shapes = nullptr;
+        pending = SceneChanges();
         bvh_root = nullptr;
     }
 
@@ -40,12 +94,15 @@ public:
         
         // Check if the object has a material and if it is emissive
         if (object->get_material() && object->get_material()->is_emissive()) {
+            object->finish_loading(); // The light samples the shape right away
             auto area_light = std::make_shared<DiffuseAreaLight>(object);
             if (area_light->power() > EPSILON) {
                 object->set_light_id(static_cast<int>(lights.size()));
                 lights.push_back(area_light);
             }
         }
+        top_level.clear();
+        packed_shapes = nullptr;
         bvh_root = nullptr; 
     }
 
@@ -67,10 +124,103 @@ public:
      * @param t1 End time for motion blur.
      */
     void build_bvh(float t0 = 0.0f, float t1 = 1.0f) {
+        finish_loading();
         if (objects.empty()) return;
+
+        // Analytic shapes go into one type-segregated PrimitiveSet, everything else stays a BVH leaf
+        std::vector<std::shared_ptr<Object>> shapes;
+        top_level.clear();
+        packed_shapes = nullptr;
+        for (const auto& object : objects) {
+            (PrimitiveSet::accepts(*object) ? shapes : top_level).push_back(object);
+        }
+        if (!shapes.empty()) {
+            std::cout << "Packing " << shapes.size() << " analytic shapes into a primitive set..." << std::endl;
+            packed_shapes = std::make_shared<PrimitiveSet>(shapes, t0, t1);
+            top_level.push_back(packed_shapes);
+        }
         
-        std::cout << "Building BVH for " << objects.size() << " objects..." << std::endl;
-        bvh_root = std::make_shared<BVHNode>(objects, t0, t1);
+        std::cout << "Building BVH for " << top_level.size() << " objects..." << std::endl;
+        bvh_root = std::make_shared<BVHNode>(top_level, t0, t1);
+    }
+
+    /**
+     * @brief Rebuild only the top level of the BVH after objects moved (e.g. Mesh::set_transform).
+     * The per-object hierarchies and the packed analytic shapes are kept, so this only sorts the
+     * bounding boxes of the top-level objects.
+     */
+    void rebuild_top_level(float t0 = 0.0f, float t1 = 1.0f) {
+        if (top_level.empty()) {
+            build_bvh(t0, t1);
+            return;
+        }
+        bvh_root = std::make_shared<BVHNode>(top_level, t0, t1);
+    }
+
+    /**
+     * @brief Report that 'object' moved or changed shape (e.g. after Mesh::set_transform).
+     */
+    void object_changed(const Object& object) {
+        pending.moved.push_back(&object);
+        if (object.get_light_id() >= 0) pending.lights = true; // Light samples follow the shape
+    }
+
+    /**
+     * @brief Report edited parameters of 'mat'.
+     */
+    void material_changed(const Material& mat) {
+        pending.materials.push_back(&mat);
+        if (mat.is_emissive()) pending.lights = true;
+    }
+
+    /**
+     * @brief Report an edited texture: it dirties every material reading it, and the environment light.
+     */
+    void texture_changed(const Texture& tex) {
+        for (const auto& object : objects) {
+            object->for_each_material([&](const Material& mat) {
+                mat.for_each_texture([&](const Texture& used) {
+                    if (&used == &tex) material_changed(mat);
+                });
+            });
+        }
+        if (env_light && env_light->texture.get() == &tex) {
+            env_light = std::make_shared<EnvironmentLight>(env_light->texture); // Rebuilds its distribution
+            pending.lights = true;
+        }
+    }
+
+    /**
+     * @brief Bring the acceleration structures and lights up to date with the reported edits.
+     * Only the parts of the BVH holding moved objects are rebuilt: meshes already refit their own
+     * hierarchy, a moved analytic shape repacks the PrimitiveSet, and the top level is re-sorted.
+     * Light powers are re-estimated only when emission changed.
+     * @return The changes, for Integrator::update() to invalidate its own caches.
+     */
+    SceneChanges commit_changes(float t0 = 0.0f, float t1 = 1.0f) {
+        SceneChanges changes = std::move(pending);
+        pending = SceneChanges();
+        std::sort(changes.materials.begin(), changes.materials.end());
+        changes.materials.erase(std::unique(changes.materials.begin(), changes.materials.end()), changes.materials.end());
+
+        if (changes.geometry()) {
+            bool repack = packed_shapes && std::any_of(changes.moved.begin(), changes.moved.end(),
+                                                       [](const Object* obj) { return PrimitiveSet::accepts(*obj); });
+            if (repack) {
+                std::vector<std::shared_ptr<Object>> shapes;
+                for (const auto& object : objects) {
+                    if (PrimitiveSet::accepts(*object)) shapes.push_back(object);
+                }
+                auto repacked = std::make_shared<PrimitiveSet>(shapes, t0, t1);
+                std::replace(top_level.begin(), top_level.end(), packed_shapes, std::shared_ptr<Object>(repacked));
+                packed_shapes = repacked;
+            }
+            rebuild_top_level(t0, t1);
+        }
+        if (changes.lights) {
+            for (const auto& light : lights) light->refresh();
+        }
+        return changes;
     }
 
     /**
@@ -102,6 +252,8 @@ public:
      * @brief Calculates the transmittance (visibility) between a ray's origin and a maximum distance.
      * Traces shadow rays. If an opaque object is hit, returns black (0).
      * If a transparent (specular) object is hit, it continues tracing but attenuates the light.
+     * Segments inside a medium (r.medium, switched at medium boundaries) are attenuated by its
+     * transmittance; boundary crossings do not count as bounces.
      * 
      * @param r The shadow ray.
      * @param max_distance The distance to the light source.
@@ -112,22 +264,40 @@ public:
         Ray current_ray = r;
         float remaining_dist = max_distance;
         
-        for(int _=0; _ < max_bounce; ++_) {
+        for (int bounce = 0, crossings = 0; bounce < max_bounce && crossings <= MEDIUM_MAX_CROSSINGS;) {
             HitRecord rec;
             // Check intersection up to the remaining distance to the light
-            if (!intersect(current_ray, SHADOW_EPSILON, remaining_dist, rec)) return throughput;
+            bool hit = intersect(current_ray, SHADOW_EPSILON, remaining_dist, rec);
+            if (current_ray.medium) {
+                throughput *= current_ray.medium->transmittance(current_ray, hit ? rec.t : remaining_dist);
+                if (near_zero(throughput)) return glm::vec3(0.0f);
+            }
+            if (!hit) return throughput;
             // We hit something before the light.
+
+            if (!rec.mat_ptr) {
+                // Medium boundary: continue in the medium on the other side
+                const Medium* next = medium_after(*rec.object->get_medium_interface(), rec, current_ray.direction());
+                current_ray = Ray(rec.p, current_ray.direction(), current_ray.time(), current_ray.get_wavelength());
+                current_ray.medium = next;
+                remaining_dist -= rec.t;
+                ++crossings;
+                continue;
+            }
                 
             // If it's a transparent material (like glass), let light pass through.
-            if (include_refraction && rec.mat_ptr->is_transparent()) {
+            if (include_refraction && material_is_transparent(*rec.mat_ptr)) {
                 // Simple Beer's law approximation or Fresnel loss.
                 // Assume 90% throughput per surface for simplicity in this model.
-                throughput *= rec.mat_ptr->evaluate_transmission(rec);
+                throughput *= material_transmission(*rec.mat_ptr, rec);
                 if(near_zero(throughput)) return glm::vec3(0.0f);
                 
                 // Move the ray forward past the object
+                const Medium* medium = current_ray.medium;
                 current_ray = Ray(rec.p, current_ray.direction(), current_ray.time(), current_ray.get_wavelength());
+                current_ray.medium = medium;
                 remaining_dist -= rec.t;
+                ++bounce;
             } else {
                 // Hit an opaque object (occluder). Shadow is black.
                 return glm::vec3(0.0f);
@@ -164,5 +334,17 @@ public:
     std::vector<std::shared_ptr<Object>> objects;
     std::vector<std::shared_ptr<Light>> lights;  // Area lights only
     std::shared_ptr<EnvironmentLight> env_light;           // Dedicated Environment Light (can be nullptr)
-    std::shared_ptr<Object> bvh_root; 
+    std::shared_ptr<Object> bvh_root;
+
+private:
+    TaskHandle env_loading; // Pending set_environment() task
+    std::vector<std::shared_ptr<Object>> top_level; // Leaves of bvh_root, kept for rebuild_top_level()
+    std::shared_ptr<Object> packed_shapes;          // The PrimitiveSet among them, if any
+    SceneChanges pending;                           // Reported since the last commit_changes()
+
+    void finish_environment() {
+        if (!env_loading) return;
+        TaskGraph::instance().wait(env_loading);
+        env_loading = nullptr;
+    } 
 };
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "scene/scene.hpp"
 #include "scene/camera.hpp"
+#include "scene/animation.hpp"
 #include "object/object_agg.hpp"
 #include "material/material_agg.hpp"
 #include "texture/texture_agg.hpp"
@@ -38,8 +39,8 @@ void scene_materials_textures(Scene& world, Camera& cam, float aspect) {
     // Normal Map Test (Front)
     // 需要确保 assets/texture/red_brick/ 路径下有纹理，否则用纯色替代
     // 这里假设你有图片，如果没有，会自动回退或报错，可根据实际情况注释掉
-    auto diff_tex = std::make_shared<ImageTexture>("assets/texture/red_brick/red_brick_diff_1k.png");
-    auto norm_tex = std::make_shared<ImageTexture>("assets/texture/red_brick/red_brick_nor_gl_1k.png");
+    auto diff_tex = load_image_texture("assets/texture/red_brick/red_brick_diff_1k.png");
+    auto norm_tex = load_image_texture("assets/texture/red_brick/red_brick_nor_gl_1k.png");
     auto mat_brick = std::make_shared<Lambertian>(diff_tex, norm_tex);
     world.add(std::make_shared<Sphere>(glm::vec3(0, 0.5, 3), 0.5f, mat_brick)); 
 
@@ -181,7 +182,7 @@ void scene_mesh_env(Scene& world, Camera& cam, float aspect) {
 
     // Background (HDR)
     // 假设有 assets/texture/hdr/puresky_1k.hdr，如果没有则用普通图片或纯色
-    world.set_background(std::make_shared<ImageTexture>("assets/envir/qwantani_puresky_1k.hdr"));
+    world.set_environment("assets/envir/qwantani_puresky_1k.hdr");
     // world.set_background(std::make_shared<SolidColor>(0.1f, 0.1f, 0.15f)); // Fallback
 
     auto mat_gold = std::make_shared<Metal>(glm::vec3(1.0f, 0.84f, 0.0f), 0.1f);
@@ -244,8 +245,8 @@ void scene_5(Scene& world, Camera& cam, float aspect) {
     // Normal Map Test (Front)
     // 需要确保 assets/texture/red_brick/ 路径下有纹理，否则用纯色替代
     // 这里假设你有图片，如果没有，会自动回退或报错，可根据实际情况注释掉
-    auto diff_tex = std::make_shared<ImageTexture>("assets/texture/broken_brick_wall/broken_brick_wall_diff_1k.png");
-    auto norm_tex = std::make_shared<ImageTexture>("assets/texture/broken_brick_wall/broken_brick_wall_nor_gl_1k.png");
+    auto diff_tex = load_image_texture("assets/texture/broken_brick_wall/broken_brick_wall_diff_1k.png");
+    auto norm_tex = load_image_texture("assets/texture/broken_brick_wall/broken_brick_wall_nor_gl_1k.png");
     auto mat_brick = std::make_shared<Lambertian>(diff_tex, norm_tex);
     world.add(std::make_shared<Sphere>(glm::vec3(4.0f, 1.0f, 0.0f), 1.0f, mat_brick)); 
     auto light_mat = std::make_shared<DiffuseLight>(glm::vec3(15.0f, 15.0f, 15.0f));
@@ -314,26 +315,27 @@ void scene_dispersion(Scene& world, Camera& cam, float aspect) {
 // 1. Manually constructed Triangular Prism
 // 2. High dispersion (Flint glass simulation)
 // 3. Projection of spectrum onto the floor
+// 4. Incremental Edits (edits != nullptr: 移动道具、修改材质/光源、调整相机)
 // =======================================================================
-void scene_prism_spectrum(Scene& world, Camera& cam, float aspect) {
+void scene_prism_spectrum(Scene& world, Camera& cam, float aspect, std::vector<SceneEdit>* edits = nullptr) {
     world.clear();
 
     // 1. Dark Room (No ambient light)
-    world.set_background(std::make_shared<ImageTexture>("assets/envir/NightSkyHDRI008_4K_HDR.hdr"));
+    world.set_environment("assets/envir/NightSkyHDRI008_4K_HDR.hdr");
 
     // 2. The Projection Screen (The Floor/Table)
     // We make it matte white to catch the rainbow clearly.
     // auto mat_screen = std::make_shared<Lambertian>(glm::vec3(0.8f));
 
-    auto desk_diff_tex = std::make_shared<ImageTexture>("assets/texture/painted_wood/PaintedWood007C_1K-PNG_Color.png");
-    auto desk_norm_tex = std::make_shared<ImageTexture>("assets/texture/painted_wood/PaintedWood007C_1K-PNG_NormalGL.png");
+    auto desk_diff_tex = load_image_texture("assets/texture/painted_wood/PaintedWood007C_1K-PNG_Color.png");
+    auto desk_norm_tex = load_image_texture("assets/texture/painted_wood/PaintedWood007C_1K-PNG_NormalGL.png");
     auto mat_desk = std::make_shared<Lambertian>(desk_diff_tex, desk_norm_tex);
     // A long floor stretching along X to catch the refracted beam
     world.add(std::make_shared<Triangle>(glm::vec3(-10,-0.5f,-5), glm::vec3(10,-0.5f,-5), glm::vec3(10,-0.5f,5), mat_desk)); 
     world.add(std::make_shared<Triangle>(glm::vec3(-10,-0.5f,-5), glm::vec3(10,-0.5f,5), glm::vec3(-10,-0.5f,5), mat_desk));
     
-    auto ground_diff_tex = std::make_shared<ImageTexture>("assets/texture/rocky_terrain/rocky_terrain_02_diff_1k.png");
-    auto ground_norm_tex = std::make_shared<ImageTexture>("assets/texture/rocky_terrain/rocky_terrain_02_nor_gl_1k.png");
+    auto ground_diff_tex = load_image_texture("assets/texture/rocky_terrain/rocky_terrain_02_diff_1k.png");
+    auto ground_norm_tex = load_image_texture("assets/texture/rocky_terrain/rocky_terrain_02_nor_gl_1k.png");
     auto mat_ground = std::make_shared<Lambertian>(ground_diff_tex, ground_norm_tex);
     world.add(std::make_shared<Disk>(glm::vec3(0.0f,-5.0f,0.0f), glm::vec3(0.0f, 1.0f, 0.0f), 75.0f, mat_ground)); 
 
@@ -397,7 +399,8 @@ void scene_prism_spectrum(Scene& world, Camera& cam, float aspect) {
     glm::vec3 l_p1 = lightCenter + (up * -0.5f * lightSize) - (right * 0.866f * lightSize);
     glm::vec3 l_p2 = lightCenter + (up * -0.5f * lightSize) + (right * 0.866f * lightSize);
 
-    auto mat_light_tri = std::make_shared<DiffuseLight>(glm::vec3(5500.0f)); 
+    auto light_color = std::make_shared<SolidColor>(glm::vec3(5500.0f));
+    auto mat_light_tri = std::make_shared<DiffuseLight>(light_color); 
 
     world.add(std::make_shared<Triangle>(l_p0, l_p2, l_p1, mat_light_tri));
 
@@ -491,6 +494,29 @@ void scene_prism_spectrum(Scene& world, Camera& cam, float aspect) {
     glm::vec3 lookat(3.0f, 0.3f, -4.0f); // Look at the area where rainbow lands
     
     cam = Camera(lookfrom, lookat, glm::vec3(0,1,0), 30.0f, aspect, 0.0f, 10.0f, 0.0f, 1.0f);
+
+    // 7. Edit Session: each edit reports what it touched, so only that is redone
+    if (edits) {
+        // Move one prop: its BVH is refit, the top level re-sorted, photons re-emitted
+        edits->push_back([inkwell_mesh](Scene& w, Camera&) {
+            inkwell_mesh->set_transform(glm::translate(glm::mat4(1.0f), glm::vec3(-0.8f, 0.0f, 0.3f)));
+            w.object_changed(*inkwell_mesh);
+        });
+        // Stronger dispersion: photons refract through the prism, so the maps are re-emitted
+        edits->push_back([mat_prism](Scene& w, Camera&) {
+            mat_prism->B = 0.08f;
+            w.material_changed(*mat_prism);
+        });
+        // Warmer beam: a texture of an emitter, so light powers and photons are redone
+        edits->push_back([light_color](Scene& w, Camera&) {
+            light_color->set_color(glm::vec3(5500.0f, 4900.0f, 4100.0f));
+            w.texture_changed(*light_color);
+        });
+        // Reframe: nothing in the scene changed, BVH and photon maps are reused as they are
+        edits->push_back([aspect, lookfrom](Scene&, Camera& c) {
+            c = Camera(lookfrom, glm::vec3(1.5f, 0.3f, -2.0f), glm::vec3(0,1,0), 30.0f, aspect, 0.0f, 10.0f, 0.0f, 1.0f);
+        });
+    }
 }
 
 
@@ -500,8 +526,9 @@ void scene_prism_spectrum(Scene& world, Camera& cam, float aspect) {
 // 1. OBJ Import Integrity (Newton bust)
 // 2. BVH Build Efficiency (Complex geometry check)
 // 3. Scale & Orientation Verification
+// 4. Turntable Animation (anim != nullptr: 胸像绕 Y 轴旋转一周, BVH refit)
 // =======================================================================
-void scene_newton_test(Scene& world, Camera& cam, float aspect) {
+void scene_newton_test(Scene& world, Camera& cam, float aspect, Animation* anim = nullptr) {
     world.clear();
 
     // 1. Setup Materials
@@ -558,4 +585,66 @@ void scene_newton_test(Scene& world, Camera& cam, float aspect) {
     
     // 禁用景深 (aperture = 0)，确保在调试阶段全图清晰
     cam = Camera(lookfrom, lookat, glm::vec3(0,1,0), 30.0f, aspect, 0.0f, 10.0f);
-}
\ No newline at end of file
+
+    // 6. Turntable: one full turn around the vertical axis through the bust
+    if (anim) {
+        anim->animate(newton_mesh, [](float t) {
+            return glm::rotate(glm::mat4(1.0f), 2.0f * PI * t, glm::vec3(0, 1, 0));
+        });
+    }
+}
+
+// =======================================================================
+// Scene 9: Newton Camera Orbit
+// 验证功能:
+// 1. Camera-only Animation (场景静止, 光子图与 BVH 在各帧间复用)
+// =======================================================================
+void scene_newton_orbit(Scene& world, Camera& cam, float aspect, Animation& anim) {
+    scene_newton_test(world, cam, aspect);
+
+    anim.animate_camera([aspect](float t) {
+        float angle = 2.0f * PI * t;
+        glm::vec3 lookfrom(6.0f * std::sin(angle), 3.5f, 6.0f * std::cos(angle)); // Frame 0 is the Scene 8 view
+        return Camera(lookfrom, glm::vec3(0.0f, 1.2f, 0.0f), glm::vec3(0,1,0), 30.0f, aspect, 0.0f, 10.0f);
+    });
+}
+// =======================================================================
+// Scene 10: Heterogeneous Smoke Plume
+// 验证功能:
+// 1. GridMedium (程序生成的密度网格, 各轴分辨率均非砖块大小的整数倍)
+// 2. Delta / Ratio Tracking (稀疏砖块 + majorant 超网格 DDA)
+// =======================================================================
+void scene_smoke_plume(Scene& world, Camera& cam, float aspect) {
+    world.clear();
+
+    auto ground = std::make_shared<Lambertian>(glm::vec3(0.5f, 0.5f, 0.5f));
+    world.add(std::make_shared<Sphere>(glm::vec3(0.0f, -1000.0f, 0.0f), 1000.0f, ground));
+
+    auto warm_light = std::make_shared<DiffuseLight>(glm::vec3(20.0f, 16.0f, 12.0f));
+    world.add(std::make_shared<Sphere>(glm::vec3(-4.0f, 6.0f, 3.0f), 1.0f, warm_light));
+
+    // A twisting column of puffs that thins out with height; the corners of the box stay empty,
+    // so only part of the bricks are stored
+    const int nx = 60, ny = 100, nz = 44;
+    const AABB box(glm::vec3(-1.5f, 0.0f, -1.1f), glm::vec3(1.5f, 5.0f, 1.1f));
+    std::vector<float> densities(size_t(nx) * ny * nz, 0.0f);
+    for (int z = 0; z < nz; ++z)
+    for (int y = 0; y < ny; ++y)
+    for (int x = 0; x < nx; ++x) {
+        const float h = (y + 0.5f) / ny;
+        const glm::vec2 axis(0.35f * std::sin(5.0f * h), 0.25f * std::cos(4.0f * h));
+        const glm::vec2 p(((x + 0.5f) / nx - 0.5f) * 3.0f, ((z + 0.5f) / nz - 0.5f) * 2.2f);
+        const float radius = 0.3f + 0.6f * h;
+        const float falloff = 1.0f - glm::length(p - axis) / radius;
+        if (falloff <= 0.0f) continue;
+        const float puffs = 0.6f + 0.4f * std::sin(23.0f * h + 7.0f * p.x) * std::cos(11.0f * p.y);
+        densities[(size_t(z) * ny + y) * nx + x] = falloff * puffs * (1.0f - 0.7f * h);
+    }
+    world.add(std::make_shared<GridMedium>(box, nx, ny, nz, densities, 12.0f, glm::vec3(0.8f)));
+
+    glm::vec3 lookfrom(0.0f, 2.5f, 12.0f);
+    glm::vec3 lookat(0.0f, 2.2f, 0.0f);
+    cam = Camera(lookfrom, lookat, glm::vec3(0.0f, 1.0f, 0.0f), 30.0f, aspect, 0.0f, 10.0f);
+
+    world.set_background(std::make_shared<SolidColor>(0.35f, 0.45f, 0.6f));
+}
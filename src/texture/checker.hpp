@@ -8,9 +8,9 @@
  * @brief A procedural checkerboard texture.
  * Great for debugging UV mappings and spatial consistency.
  */
-class CheckerTexture : public Texture {
+class CheckerTexture final : public Texture {
 public:
-    CheckerTexture() {}
+    CheckerTexture() : Texture(TextureKind::Checker) {}
 
     /**
      * @brief Creates a checkerboard from two other textures.
@@ -20,13 +20,13 @@ public:
      * @param _scale Control the density of the pattern.
      */
     CheckerTexture(std::shared_ptr<Texture> _even, std::shared_ptr<Texture> _odd, float _scale = 10.0f)
-        : even(_even), odd(_odd), scale(_scale) {}
+        : Texture(TextureKind::Checker), even(_even), odd(_odd), scale(_scale) {}
 
     /**
      * @brief Creates a checkerboard from two colors.
      */
     CheckerTexture(glm::vec3 c1, glm::vec3 c2, float _scale = 10.0f)
-        : even(std::make_shared<SolidColor>(c1)), odd(std::make_shared<SolidColor>(c2)), scale(_scale) {}
+        : Texture(TextureKind::Checker), even(std::make_shared<SolidColor>(c1)), odd(std::make_shared<SolidColor>(c2)), scale(_scale) {}
 
     virtual glm::vec3 value(float u, float v, const glm::vec3& p) const override {
         // Use spatial coordinates for 3D checkerboard
@@ -38,6 +38,11 @@ public:
             return even->value(u, v, p);
     }
 
+    virtual glm::vec3 value(float u, float v, const glm::vec3& p, float uv_width) const override {
+        float sines = sin(scale * p.x) * sin(scale * p.y) * sin(scale * p.z);
+        return (sines < 0) ? odd->value(u, v, p, uv_width) : even->value(u, v, p, uv_width);
+    }
+
 public:
     std::shared_ptr<Texture> even;
     std::shared_ptr<Texture> odd;
@@ -1,115 +1,215 @@
 #pragma once
 
 #include "texture_utils.hpp"
+#include "texel_kernel.hpp"
 #include "../core/utils.hpp"
 #include <iostream>
+#include <vector>
 #include <algorithm> // for std::clamp
 
-#include "stb_image.h" 
+#include "stb_image.h"
 
 /**
  * @brief Texture backed by an image file.
  * Supports both LDR (Standard images) and HDR (Radiance RGBE) formats.
- * Uses Bilinear Interpolation for smooth sampling.
+ * Texels are stored as padded RGBA (8-bit for LDR, float for HDR) so that each bilinear tap is a
+ * single 4-wide load and the four taps are blended in one SIMD pass (see texel_kernel.hpp).
+ * A MIP pyramid is built at load time: footprint-aware lookups are trilinear,
+ * plain lookups use Bilinear Interpolation on the full resolution level.
  */
-class ImageTexture : public Texture {
+class ImageTexture final : public Texture {
 public:
-    const static int BYTES_PER_PIXEL = 3;
+    const static int BYTES_PER_PIXEL = 3; // Components requested from the decoder
+    const static int CHANNELS = 4;        // Stored components (RGB + padding)
 
     /**
      * @brief Construct a new Image Texture.
-     * 
+     *
      * @param filename Path to the image file.
      */
-    ImageTexture(const char* filename) {
+    ImageTexture(const char* filename) : Texture(TextureKind::Image) {
         int components_per_pixel = BYTES_PER_PIXEL;
-        
+        int width = 0, height = 0;
+        MipLevel base;
+
         // Attempt to load as floating point first (for HDR)
         if (stbi_is_hdr(filename)) {
-            data_f = stbi_loadf(filename, &width, &height, &components_per_pixel, components_per_pixel);
+            float* data_f = stbi_loadf(filename, &width, &height, &components_per_pixel, BYTES_PER_PIXEL);
+            if (data_f) {
+                base.data_f = pad_to_rgba(data_f, size_t(width) * height, 1.0f);
+                stbi_image_free(data_f);
+            }
             is_hdr = true;
         } else {
-            data_u8 = stbi_load(filename, &width, &height, &components_per_pixel, components_per_pixel);
+            unsigned char* data_u8 = stbi_load(filename, &width, &height, &components_per_pixel, BYTES_PER_PIXEL);
+            if (data_u8) {
+                base.data_u8 = pad_to_rgba(data_u8, size_t(width) * height, static_cast<unsigned char>(255));
+                stbi_image_free(data_u8);
+            }
             is_hdr = false;
         }
 
-        if (!data_u8 && !data_f) {
+        if (base.data_u8.empty() && base.data_f.empty()) {
             std::cerr << "ERROR: Could not load texture image file '" << filename << "'.\n";
-            width = height = 0;
+            return;
         }
-        
-        bytes_per_scanline = BYTES_PER_PIXEL * width;
-    }
 
-    ~ImageTexture() {
-        if (data_u8) stbi_image_free(data_u8);
-        if (data_f)  stbi_image_free(data_f);
+        base.width = width;
+        base.height = height;
+        levels.push_back(std::move(base));
+        build_mip_chain();
     }
 
     virtual glm::vec3 value(float u, float v, const glm::vec3& p) const override {
         // If no texture data, return solid magenta (debug color)
-        if (data_u8 == nullptr && data_f == nullptr)
+        if (levels.empty())
+            return glm::vec3(1, 0, 1);
+        return bilinear(levels[0], u, v);
+    }
+
+    /**
+     * @brief Trilinear lookup: the MIP level is chosen so that one texel matches the footprint width.
+     */
+    virtual glm::vec3 value(float u, float v, const glm::vec3& p, float uv_width) const override {
+        if (levels.empty())
             return glm::vec3(1, 0, 1);
 
-        // Clamp input texture coordinates to [0,1] x [1,0]
-        u = std::clamp(u, 0.0f, 1.0f);
-        v = 1.0f - std::clamp(v, 0.0f, 1.0f); // Flip V to image coordinates
-
-        // Map UV to image coordinates
-        float i = u * width;
-        float j = v * height;
-
-        // --- Bilinear Interpolation ---
-        // Get the coordinates of the top-left pixel
-        int x0 = static_cast<int>(i - 0.5f);
-        int y0 = static_cast<int>(j - 0.5f);
-        
-        // Local coordinates within the pixel [0, 1]
-        float s = i - 0.5f - x0;
-        float t = j - 0.5f - y0;
-
-        // Sample 4 neighbors
-        glm::vec3 c00 = get_pixel(x0, y0);
-        glm::vec3 c10 = get_pixel(x0 + 1, y0);
-        glm::vec3 c01 = get_pixel(x0, y0 + 1);
-        glm::vec3 c11 = get_pixel(x0 + 1, y0 + 1);
-
-        // Interpolate X
-        glm::vec3 c0 = glm::mix(c00, c10, s);
-        glm::vec3 c1 = glm::mix(c01, c11, s);
-
-        // Interpolate Y
-        return glm::mix(c0, c1, t);
+        float texels = uv_width * std::max(levels[0].width, levels[0].height);
+        if (texels <= 1.0f || levels.size() == 1)
+            return bilinear(levels[0], u, v);
+
+        float lambda = std::min(std::log2(texels), float(levels.size() - 1));
+        int l0 = static_cast<int>(lambda);
+        if (l0 >= static_cast<int>(levels.size()) - 1)
+            return bilinear(levels.back(), u, v);
+
+        return glm::mix(bilinear(levels[l0], u, v), bilinear(levels[l0 + 1], u, v), lambda - l0);
     }
 
-    int get_width() const { return width; } // Added for Importance Sampling Support
-    int get_height() const { return height; } // Added for Importance Sampling Support
+    int get_width() const { return levels.empty() ? 0 : levels[0].width; } // Added for Importance Sampling Support
+    int get_height() const { return levels.empty() ? 0 : levels[0].height; } // Added for Importance Sampling Support
+    int get_level_count() const { return static_cast<int>(levels.size()); }
+    bool get_is_hdr() const { return is_hdr; }
+
+    /**
+     * @brief One level of the MIP pyramid, padded RGBA in the same precision as the source image.
+     */
+    struct MipLevel {
+        int width = 0;
+        int height = 0;
+        std::vector<unsigned char> data_u8; // LDR
+        std::vector<float> data_f;          // HDR
+    };
+
+    const MipLevel& get_level(int i) const { return levels[i]; }
+
     /**
      * @brief Helper to fetch pixel color safely (handles wrapping/clamping).
      */
     glm::vec3 get_pixel(int x, int y) const {
-        x = std::clamp(x, 0, width - 1);
-        y = std::clamp(y, 0, height - 1);
-
-        if (is_hdr && data_f) {
-            int index = (y * width + x) * BYTES_PER_PIXEL;
-            return glm::vec3(data_f[index], data_f[index+1], data_f[index+2]);
-        } else if (data_u8) {
-            int index = (y * width + x) * BYTES_PER_PIXEL;
-            constexpr float color_scale = 1.0f / 255.0f;
-            return glm::vec3(
-                data_u8[index] * color_scale,
-                data_u8[index+1] * color_scale,
-                data_u8[index+2] * color_scale
-            );
-        }
-        return glm::vec3(0.0f);
+        if (levels.empty()) return glm::vec3(0.0f);
+        return texel(levels[0], x, y);
     }
 
 private:
-    unsigned char* data_u8 = nullptr;
-    float* data_f = nullptr;
-    int width, height;
-    int bytes_per_scanline;
+    std::vector<MipLevel> levels;
     bool is_hdr = false;
-};
\ No newline at end of file
+
+    template <typename T>
+    static std::vector<T> pad_to_rgba(const T* rgb, size_t pixel_count, T alpha) {
+        std::vector<T> rgba(pixel_count * CHANNELS);
+        for (size_t i = 0; i < pixel_count; ++i) {
+            rgba[i * CHANNELS + 0] = rgb[i * BYTES_PER_PIXEL + 0];
+            rgba[i * CHANNELS + 1] = rgb[i * BYTES_PER_PIXEL + 1];
+            rgba[i * CHANNELS + 2] = rgb[i * BYTES_PER_PIXEL + 2];
+            rgba[i * CHANNELS + 3] = alpha;
+        }
+        return rgba;
+    }
+
+    size_t texel_index(const MipLevel& level, int x, int y) const {
+        x = std::clamp(x, 0, level.width - 1);
+        y = std::clamp(y, 0, level.height - 1);
+        return (size_t(y) * level.width + x) * CHANNELS;
+    }
+
+    glm::vec3 texel(const MipLevel& level, int x, int y) const {
+        size_t index = texel_index(level, x, y);
+        if (is_hdr) {
+            return glm::vec3(level.data_f[index], level.data_f[index+1], level.data_f[index+2]);
+        }
+        const auto& lut = u8_to_float_table();
+        return glm::vec3(lut[level.data_u8[index]], lut[level.data_u8[index+1]], lut[level.data_u8[index+2]]);
+    }
+
+    glm::vec3 bilinear(const MipLevel& level, float u, float v) const {
+        BilinearTaps taps = bilinear_taps(u, v, level.width, level.height);
+
+        // Offsets of the 4 neighbors
+        size_t i00 = texel_index(level, taps.x0, taps.y0);
+        size_t i10 = texel_index(level, taps.x0 + 1, taps.y0);
+        size_t i01 = texel_index(level, taps.x0, taps.y0 + 1);
+        size_t i11 = texel_index(level, taps.x0 + 1, taps.y0 + 1);
+
+        if (is_hdr) {
+            const float* d = level.data_f.data();
+            return bilerp_rgba(d + i00, d + i10, d + i01, d + i11, taps.s, taps.t);
+        }
+        const unsigned char* d = level.data_u8.data();
+        return bilerp_rgba(d + i00, d + i10, d + i01, d + i11, taps.s, taps.t);
+    }
+
+    /**
+     * @brief Box filter weights of destination texel 'd' along one axis, starting at source texel 2d.
+     * Even sizes average 2 texels; odd sizes use 3 taps covering [d, d+1) * src/dst, so the last
+     * row / column is not dropped and NPOT levels keep their alignment and brightness.
+     * @return Number of taps (1 to 3) written to 'w'.
+     */
+    static int footprint(int src_size, int dst_size, int d, float w[3]) {
+        if (src_size == 1) { w[0] = 1.0f; return 1; }
+        if (src_size % 2 == 0) { w[0] = w[1] = 0.5f; return 2; }
+        const float inv = 1.0f / float(src_size);
+        w[0] = float(dst_size - d) * inv;
+        w[1] = float(dst_size) * inv;
+        w[2] = float(d + 1) * inv;
+        return 3;
+    }
+
+    /**
+     * @brief Build levels 1..n by box filtering until the image is 1x1: 2 taps along even axes,
+     * 3 along odd ones (see footprint()).
+     */
+    void build_mip_chain() {
+        while (levels.back().width > 1 || levels.back().height > 1) {
+            const MipLevel& src = levels.back();
+            MipLevel dst;
+            dst.width = std::max(1, src.width / 2);
+            dst.height = std::max(1, src.height / 2);
+            size_t count = size_t(dst.width) * dst.height * CHANNELS;
+            if (is_hdr) dst.data_f.resize(count);
+            else        dst.data_u8.resize(count);
+
+            #pragma omp parallel for schedule(static)
+            for (int y = 0; y < dst.height; ++y) {
+                float wy[3];
+                int ny = footprint(src.height, dst.height, y, wy);
+                for (int x = 0; x < dst.width; ++x) {
+                    float wx[3];
+                    int nx = footprint(src.width, dst.width, x, wx);
+                    glm::vec3 avg(0.0f);
+                    for (int ty = 0; ty < ny; ++ty)
+                        for (int tx = 0; tx < nx; ++tx)
+                            avg += wx[tx] * wy[ty] * texel(src, 2 * x + tx, 2 * y + ty);
+                    size_t index = (size_t(y) * dst.width + x) * CHANNELS;
+                    for (int c = 0; c < BYTES_PER_PIXEL; ++c) {
+                        if (is_hdr) dst.data_f[index + c] = avg[c];
+                        else        dst.data_u8[index + c] = static_cast<unsigned char>(std::clamp(avg[c] * 255.0f + 0.5f, 0.0f, 255.0f));
+                    }
+                    if (is_hdr) dst.data_f[index + 3] = 1.0f;
+                    else        dst.data_u8[index + 3] = 255;
+                }
+            }
+            levels.push_back(std::move(dst));
+        }
+    }
+};
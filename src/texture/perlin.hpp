@@ -129,10 +129,10 @@ private:
  * @brief Texture generated using Perlin Noise.
  * Implements a marble-like pattern using turbulence.
  */
-class Perlin : public Texture {
+class Perlin final : public Texture {
 public:
-    Perlin() : scale(1.0f) {}
-    Perlin(float sc) : scale(sc) {}
+    Perlin() : Texture(TextureKind::Perlin), scale(1.0f) {}
+    Perlin(float sc) : Texture(TextureKind::Perlin), scale(sc) {}
 
     /**
      * @brief Samples the Perlin texture.
@@ -5,14 +5,14 @@
  * @brief A texture that returns a constant color regardless of coordinates.
  * Adapts a simple color to the Texture interface.
  */
-class SolidColor : public Texture {
+class SolidColor final : public Texture {
 public:
-    SolidColor() {}
+    SolidColor() : Texture(TextureKind::SolidColor) {}
     
     /**
      * @brief Construct a SolidColor from a vector.
      */
-    SolidColor(const glm::vec3& c) : color_value(c) {}
+    SolidColor(const glm::vec3& c) : Texture(TextureKind::SolidColor), color_value(c) {}
 
     /**
      * @brief Construct a SolidColor from r, g, b components.
@@ -23,6 +23,11 @@ public:
         return color_value;
     }
 
+    /**
+     * @brief Edit the color; report it with Scene::texture_changed() before rendering again.
+     */
+    void set_color(const glm::vec3& c) { color_value = c; }
+
 private:
     glm::vec3 color_value;
 };
\ No newline at end of file
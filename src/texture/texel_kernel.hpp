@@ -0,0 +1,95 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TEXEL_KERNEL_SSE 1
+#endif
+
+/**
+ * @brief Bilinear footprint of a (u, v) lookup on a width x height image:
+ * the top-left tap (possibly one texel outside the image) and the fractional weights towards the next texel.
+ */
+struct BilinearTaps {
+    int x0, y0;
+    float s, t;
+};
+
+inline BilinearTaps bilinear_taps(float u, float v, int width, int height) {
+    u = std::clamp(u, 0.0f, 1.0f);
+    v = std::clamp(v, 0.0f, 1.0f);
+    float i = u * width - 0.5f;
+    float j = (1.0f - v) * height - 0.5f; // Flip V to image rows
+    float fi = std::floor(i);
+    float fj = std::floor(j);
+    return {static_cast<int>(fi), static_cast<int>(fj), i - fi, j - fj};
+}
+
+/**
+ * @brief 8-bit channel to float, computed once.
+ */
+inline const std::array<float, 256>& u8_to_float_table() {
+    static const std::array<float, 256> table = [] {
+        std::array<float, 256> t{};
+        for (int i = 0; i < 256; ++i) t[i] = i / 255.0f;
+        return t;
+    }();
+    return table;
+}
+
+/**
+ * @brief Blend four RGBA float taps (a b / c d) with bilinear weights (s, t).
+ * All four taps are combined in one 4-wide pass; the alpha lane is padding.
+ */
+inline glm::vec3 bilerp_rgba(const float* a, const float* b, const float* c, const float* d, float s, float t) {
+#ifdef TEXEL_KERNEL_SSE
+    __m128 r = _mm_mul_ps(_mm_loadu_ps(a), _mm_set1_ps((1.0f - s) * (1.0f - t)));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(b), _mm_set1_ps(s * (1.0f - t))));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(c), _mm_set1_ps((1.0f - s) * t)));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(d), _mm_set1_ps(s * t)));
+    alignas(16) float out[4];
+    _mm_store_ps(out, r);
+    return glm::vec3(out[0], out[1], out[2]);
+#else
+    glm::vec3 c0 = glm::mix(glm::vec3(a[0], a[1], a[2]), glm::vec3(b[0], b[1], b[2]), s);
+    glm::vec3 c1 = glm::mix(glm::vec3(c[0], c[1], c[2]), glm::vec3(d[0], d[1], d[2]), s);
+    return glm::mix(c0, c1, t);
+#endif
+}
+
+/**
+ * @brief Blend four RGBA8 taps (a b / c d) with bilinear weights (s, t).
+ * The SSE path widens all 16 bytes at once; the scalar path goes through the conversion table.
+ */
+inline glm::vec3 bilerp_rgba(const unsigned char* a, const unsigned char* b, const unsigned char* c, const unsigned char* d, float s, float t) {
+#ifdef TEXEL_KERNEL_SSE
+    int32_t packed[4];
+    std::memcpy(&packed[0], a, 4);
+    std::memcpy(&packed[1], b, 4);
+    std::memcpy(&packed[2], c, 4);
+    std::memcpy(&packed[3], d, 4);
+    __m128i taps = _mm_loadu_si128(reinterpret_cast<const __m128i*>(packed));
+    __m128i zero = _mm_setzero_si128();
+    __m128i ab = _mm_unpacklo_epi8(taps, zero);
+    __m128i cd = _mm_unpackhi_epi8(taps, zero);
+
+    __m128 r = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(ab, zero)), _mm_set1_ps((1.0f - s) * (1.0f - t)));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(ab, zero)), _mm_set1_ps(s * (1.0f - t))));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(cd, zero)), _mm_set1_ps((1.0f - s) * t)));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(cd, zero)), _mm_set1_ps(s * t)));
+    r = _mm_mul_ps(r, _mm_set1_ps(1.0f / 255.0f));
+    alignas(16) float out[4];
+    _mm_store_ps(out, r);
+    return glm::vec3(out[0], out[1], out[2]);
+#else
+    const auto& lut = u8_to_float_table();
+    auto load = [&](const unsigned char* px) { return glm::vec3(lut[px[0]], lut[px[1]], lut[px[2]]); };
+    return glm::mix(glm::mix(load(a), load(b), s), glm::mix(load(c), load(d), s), t);
+#endif
+}
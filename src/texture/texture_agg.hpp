@@ -3,4 +3,6 @@
 #include "checker.hpp"
 #include "perlin.hpp"
 #include "image_texture.hpp"
+#include "texture_cache.hpp"
+#include "texture_registry.hpp"
 #include "solid_color.hpp"
\ No newline at end of file
@@ -0,0 +1,389 @@
+#pragma once
+
+#include "texture_utils.hpp"
+#include "image_texture.hpp"
+#include "../core/utils.hpp"
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Process-wide pool of texture tiles with an LRU memory budget.
+ *
+ * Tiles are keyed by (texture id, MIP level, tile index) and spread over independently locked shards,
+ * so concurrent lookups from render threads rarely contend and never take a global lock.
+ * Each thread additionally remembers its last tile, which absorbs the 4 taps of a bilinear lookup
+ * and the strong spatial coherence of camera rays without touching any lock.
+ */
+class TextureCache {
+public:
+    using Tile = std::vector<unsigned char>;
+    using TilePtr = std::shared_ptr<const Tile>;
+
+    static TextureCache& instance() {
+        static TextureCache cache;
+        return cache;
+    }
+
+    /**
+     * @brief Set the memory budget (bytes) shared by all tiled textures.
+     * Tiles in use by a thread stay alive until released even if evicted.
+     */
+    void set_capacity(size_t bytes) { capacity_bytes = bytes; }
+    size_t capacity() const { return capacity_bytes; }
+
+    size_t memory_usage() const {
+        size_t total = 0;
+        for (const auto& shard : shards) total += shard.bytes.load(std::memory_order_relaxed);
+        return total;
+    }
+
+    /**
+     * @brief Hand out a unique id for a texture's tile keys.
+     */
+    uint32_t register_texture() { return next_texture_id++; }
+
+    static uint64_t make_key(uint32_t texture_id, int level, int tile_index) {
+        return (uint64_t(texture_id) << 40) | (uint64_t(level & 0xFF) << 32) | uint32_t(tile_index);
+    }
+
+    /**
+     * @brief Return the tile for 'key', calling 'load' (outside of any lock) on a miss.
+     */
+    template <typename Loader>
+    TilePtr get(uint64_t key, Loader&& load) {
+        // Per-thread last tile: no locking for repeated hits on the same tile
+        LastTile& last = last_tile();
+        if (key == last.key) return last.tile;
+
+        Shard& shard = shards[shard_index(key)];
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto it = shard.map.find(key);
+            if (it != shard.map.end()) {
+                shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+                last.key = key;
+                last.tile = it->second->second;
+                return last.tile;
+            }
+        }
+
+        // Miss: read the tile without holding the shard lock
+        TilePtr tile = std::make_shared<const Tile>(load());
+
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto it = shard.map.find(key);
+            if (it != shard.map.end()) {
+                // Another thread loaded it meanwhile: use theirs
+                tile = it->second->second;
+            } else {
+                shard.lru.emplace_front(key, tile);
+                shard.map[key] = shard.lru.begin();
+                shard.bytes += tile->size();
+                evict(shard);
+            }
+        }
+
+        last.key = key;
+        last.tile = tile;
+        return tile;
+    }
+
+private:
+    struct Shard {
+        std::mutex mutex;
+        std::list<std::pair<uint64_t, TilePtr>> lru; // Most recently used first
+        std::unordered_map<uint64_t, std::list<std::pair<uint64_t, TilePtr>>::iterator> map;
+        std::atomic<size_t> bytes{0};
+    };
+
+    std::array<Shard, TEXTURE_CACHE_SHARDS> shards;
+    std::atomic<size_t> capacity_bytes{size_t(TEXTURE_CACHE_DEFAULT_MB) << 20};
+    std::atomic<uint32_t> next_texture_id{0};
+
+    struct LastTile {
+        uint64_t key = ~uint64_t(0);
+        TilePtr tile;
+    };
+
+    TextureCache() = default;
+
+    static LastTile& last_tile() {
+        thread_local LastTile last;
+        return last;
+    }
+
+    static size_t shard_index(uint64_t key) {
+        // Mix the bits so neighbouring tiles land on different shards
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        return key % TEXTURE_CACHE_SHARDS;
+    }
+
+    /**
+     * @brief Drop least recently used tiles until the shard fits its share of the budget (keeps at least one).
+     */
+    void evict(Shard& shard) {
+        size_t budget = capacity_bytes / TEXTURE_CACHE_SHARDS;
+        while (shard.bytes > budget && shard.lru.size() > 1) {
+            auto& victim = shard.lru.back();
+            shard.bytes -= victim.second->size();
+            shard.map.erase(victim.first);
+            shard.lru.pop_back();
+        }
+    }
+};
+
+/**
+ * @brief Image texture whose texels live in a tiled on-disk file and are paged in on demand.
+ *
+ * Construction only records the path. On the first lookup the image is converted once into
+ * "<file>.ttex" (all MIP levels, split into TEXTURE_TILE_SIZE^2 tiles) unless an up-to-date
+ * conversion exists; afterwards only the tiles that rays actually touch are read, through the
+ * shared TextureCache. Images that are never hit cost neither decode time nor memory.
+ * With 'paged' off the image is simply decoded into memory on first use (or by load()).
+ */
+class TiledImageTexture final : public Texture {
+    using Tile = TextureCache::Tile;
+
+public:
+    TiledImageTexture(const std::string& filename, bool paged = true)
+        : Texture(TextureKind::TiledImage), filename(filename), tiled_path(filename + ".ttex"), paged(paged),
+          texture_id(TextureCache::instance().register_texture()) {}
+
+    /**
+     * @brief Convert / open (or decode) the image now instead of on the first lookup.
+     * Safe to call concurrently with lookups; the work happens exactly once.
+     */
+    void load() const {
+        std::call_once(open_flag, [this] { open(); });
+    }
+
+    /**
+     * @brief Scene-load work for the texture registry. A paged texture checks the tiled file's
+     * header and converts the image if it is missing or stale; tiles are still only read when
+     * first sampled. An unpaged texture is decoded, so no render thread has to wait on it.
+     */
+    void prepare() const {
+        load();
+    }
+
+    virtual glm::vec3 value(float u, float v, const glm::vec3& p) const override {
+        return value(u, v, p, 0.0f);
+    }
+
+    /**
+     * @brief Trilinear lookup, same level selection as ImageTexture.
+     */
+    virtual glm::vec3 value(float u, float v, const glm::vec3& p, float uv_width) const override {
+        load();
+        if (resident) return resident->value(u, v, p, uv_width);
+        if (levels.empty()) return glm::vec3(1, 0, 1);
+
+        float texels = uv_width * std::max(levels[0].width, levels[0].height);
+        if (texels <= 1.0f || levels.size() == 1)
+            return bilinear(0, u, v);
+
+        float lambda = std::min(std::log2(texels), float(levels.size() - 1));
+        int l0 = static_cast<int>(lambda);
+        if (l0 >= static_cast<int>(levels.size()) - 1)
+            return bilinear(static_cast<int>(levels.size()) - 1, u, v);
+
+        return glm::mix(bilinear(l0, u, v), bilinear(l0 + 1, u, v), lambda - l0);
+    }
+
+private:
+    struct LevelInfo {
+        int width, height;
+        int tiles_x, tiles_y;
+        int first_tile; // Index of the level's first tile in the file
+    };
+
+    struct FileHeader {
+        char magic[8];
+        uint64_t source_size;
+        int64_t source_mtime;
+        int32_t is_hdr;
+        int32_t tile_size;
+        int32_t num_levels;
+    };
+    static constexpr char FILE_MAGIC[8] = {'T', 'T', 'E', 'X', '0', '0', '0', '3'};
+
+    std::string filename;
+    std::string tiled_path;
+    bool paged;
+    uint32_t texture_id;
+
+    // Filled once by open()
+    mutable std::once_flag open_flag;
+    mutable std::vector<LevelInfo> levels;
+    mutable bool is_hdr = false;
+    mutable size_t tile_bytes = 0;
+    mutable std::streamoff data_offset = 0;
+    mutable std::shared_ptr<ImageTexture> resident; // Unpaged textures, or fallback when the tiled file cannot be written
+
+    // Tile reads happen only on cache misses; a per-texture lock keeps the stream consistent.
+    mutable std::ifstream file;
+    mutable std::mutex file_mutex;
+
+    /**
+     * @brief Read the tiled file header, converting the source image first if needed.
+     */
+    void open() const {
+        if (!paged) {
+            resident = std::make_shared<ImageTexture>(filename.c_str());
+            return;
+        }
+        if (!read_header()) {
+            ImageTexture decoded(filename.c_str());
+            if (decoded.get_level_count() == 0) return;
+            if (!write_tiled(decoded) || !read_header()) {
+                std::cerr << "[TextureCache] Warning: cannot use " << tiled_path << ", keeping " << filename << " in memory." << std::endl;
+                resident = std::make_shared<ImageTexture>(std::move(decoded));
+            }
+        }
+    }
+
+    bool read_header() const {
+        file.open(tiled_path, std::ios::binary);
+        if (!file) return false;
+
+        FileHeader header;
+        uint64_t size;
+        int64_t mtime;
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))
+            || std::memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0
+            || !file_stamp(filename, size, mtime)
+            || header.source_size != size || header.source_mtime != mtime
+            || header.tile_size != TEXTURE_TILE_SIZE || header.num_levels <= 0) {
+            file.close();
+            return false;
+        }
+
+        is_hdr = header.is_hdr != 0;
+        tile_bytes = size_t(TEXTURE_TILE_SIZE) * TEXTURE_TILE_SIZE * ImageTexture::CHANNELS * (is_hdr ? sizeof(float) : 1);
+        levels.clear();
+        int tile_count = 0;
+        for (int l = 0; l < header.num_levels; ++l) {
+            int32_t dims[2];
+            if (!file.read(reinterpret_cast<char*>(dims), sizeof(dims))) { file.close(); levels.clear(); return false; }
+            LevelInfo info{dims[0], dims[1],
+                           (dims[0] + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE,
+                           (dims[1] + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE, tile_count};
+            tile_count += info.tiles_x * info.tiles_y;
+            levels.push_back(info);
+        }
+        data_offset = file.tellg();
+        return true;
+    }
+
+    /**
+     * @brief Convert a decoded image into the tiled layout. Edge tiles are padded by clamping.
+     */
+    bool write_tiled(const ImageTexture& image) const {
+        FileHeader header{};
+        std::memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+        if (!file_stamp(filename, header.source_size, header.source_mtime)) return false;
+        header.is_hdr = image.get_is_hdr() ? 1 : 0;
+        header.tile_size = TEXTURE_TILE_SIZE;
+        header.num_levels = image.get_level_count();
+
+        // Textures convert concurrently: write a private file and rename it into place, so a reader
+        // (or another run converting the same image) never sees a partial tiled file
+        std::ostringstream tmp_name;
+        tmp_name << tiled_path << ".tmp" << std::this_thread::get_id();
+        const std::string tmp_path = tmp_name.str();
+        std::ofstream out(tmp_path, std::ios::binary);
+        if (!out) return false;
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (int l = 0; l < header.num_levels; ++l) {
+            int32_t dims[2] = {image.get_level(l).width, image.get_level(l).height};
+            out.write(reinterpret_cast<const char*>(dims), sizeof(dims));
+        }
+
+        size_t texel_bytes = ImageTexture::CHANNELS * (header.is_hdr ? sizeof(float) : 1);
+        Tile tile(size_t(TEXTURE_TILE_SIZE) * TEXTURE_TILE_SIZE * texel_bytes);
+        for (int l = 0; l < header.num_levels; ++l) {
+            const auto& level = image.get_level(l);
+            const unsigned char* src = header.is_hdr
+                ? reinterpret_cast<const unsigned char*>(level.data_f.data())
+                : level.data_u8.data();
+            int tiles_x = (level.width + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE;
+            int tiles_y = (level.height + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE;
+            for (int ty = 0; ty < tiles_y; ++ty) {
+                for (int tx = 0; tx < tiles_x; ++tx) {
+                    for (int y = 0; y < TEXTURE_TILE_SIZE; ++y) {
+                        int sy = std::min(ty * TEXTURE_TILE_SIZE + y, level.height - 1);
+                        for (int x = 0; x < TEXTURE_TILE_SIZE; ++x) {
+                            int sx = std::min(tx * TEXTURE_TILE_SIZE + x, level.width - 1);
+                            std::memcpy(&tile[(size_t(y) * TEXTURE_TILE_SIZE + x) * texel_bytes],
+                                        &src[(size_t(sy) * level.width + sx) * texel_bytes], texel_bytes);
+                        }
+                    }
+                    out.write(reinterpret_cast<const char*>(tile.data()), tile.size());
+                }
+            }
+        }
+
+        out.close();
+        std::error_code ec;
+        if (out.fail()) std::filesystem::remove(tmp_path, ec);
+        else std::filesystem::rename(tmp_path, tiled_path, ec);
+        return !out.fail() && !ec;
+    }
+
+    Tile read_tile(int tile_index) const {
+        Tile tile(tile_bytes, 0);
+        std::lock_guard<std::mutex> lock(file_mutex);
+        file.clear();
+        file.seekg(data_offset + std::streamoff(tile_index) * std::streamoff(tile_bytes));
+        file.read(reinterpret_cast<char*>(tile.data()), tile_bytes);
+        return tile;
+    }
+
+    /**
+     * @brief Address of texel (x, y) of level 'l'; 'tile' keeps the owning tile alive while it is read.
+     */
+    const unsigned char* texel(int l, int x, int y, TextureCache::TilePtr& tile) const {
+        const LevelInfo& level = levels[l];
+        x = std::clamp(x, 0, level.width - 1);
+        y = std::clamp(y, 0, level.height - 1);
+
+        int tile_index = level.first_tile + (y / TEXTURE_TILE_SIZE) * level.tiles_x + (x / TEXTURE_TILE_SIZE);
+        tile = TextureCache::instance().get(
+            TextureCache::make_key(texture_id, l, tile_index), [&] { return read_tile(tile_index); });
+
+        size_t index = (size_t(y % TEXTURE_TILE_SIZE) * TEXTURE_TILE_SIZE + (x % TEXTURE_TILE_SIZE)) * ImageTexture::CHANNELS;
+        return tile->data() + index * (is_hdr ? sizeof(float) : 1);
+    }
+
+    glm::vec3 bilinear(int l, float u, float v) const {
+        const LevelInfo& level = levels[l];
+        BilinearTaps taps = bilinear_taps(u, v, level.width, level.height);
+
+        TextureCache::TilePtr t00, t10, t01, t11;
+        const unsigned char* c00 = texel(l, taps.x0, taps.y0, t00);
+        const unsigned char* c10 = texel(l, taps.x0 + 1, taps.y0, t10);
+        const unsigned char* c01 = texel(l, taps.x0, taps.y0 + 1, t01);
+        const unsigned char* c11 = texel(l, taps.x0 + 1, taps.y0 + 1, t11);
+
+        if (is_hdr) {
+            return bilerp_rgba(reinterpret_cast<const float*>(c00), reinterpret_cast<const float*>(c10),
+                               reinterpret_cast<const float*>(c01), reinterpret_cast<const float*>(c11), taps.s, taps.t);
+        }
+        return bilerp_rgba(c00, c10, c01, c11, taps.s, taps.t);
+    }
+};
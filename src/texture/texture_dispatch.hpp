@@ -0,0 +1,27 @@
+#pragma once
+
+#include "texture_utils.hpp"
+#include "solid_color.hpp"
+#include "checker.hpp"
+#include "image_texture.hpp"
+#include "texture_cache.hpp"
+#include "perlin.hpp"
+
+/**
+ * @brief Texture lookup dispatched on Texture::kind instead of the vtable.
+ * Every texture of the closed set is 'final', so the call inside each case is resolved statically
+ * and can be inlined into the shading code (a SolidColor lookup becomes a plain load).
+ * Unknown textures fall back to the virtual interface.
+ *
+ * @param uv_width Ray footprint in UV units (0 = unfiltered), ignored by textures without MIP data.
+ */
+inline glm::vec3 texture_value(const Texture& tex, float u, float v, const glm::vec3& p, float uv_width = 0.0f) {
+    switch (tex.kind) {
+    case TextureKind::SolidColor: return static_cast<const SolidColor&>(tex).value(u, v, p);
+    case TextureKind::Checker:    return static_cast<const CheckerTexture&>(tex).value(u, v, p, uv_width);
+    case TextureKind::Image:      return static_cast<const ImageTexture&>(tex).value(u, v, p, uv_width);
+    case TextureKind::TiledImage: return static_cast<const TiledImageTexture&>(tex).value(u, v, p, uv_width);
+    case TextureKind::Perlin:     return static_cast<const Perlin&>(tex).value(u, v, p);
+    default:                      return tex.value(u, v, p, uv_width);
+    }
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "texture_cache.hpp"
+#include "../core/task_graph.hpp"
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Global switch for load_image_texture (set before building the scene).
+ */
+inline bool& texture_cache_enabled() {
+    static bool enabled = true;
+    return enabled;
+}
+
+/**
+ * @brief Process-wide registry of image textures, keyed by canonical file path.
+ *
+ * Every image is turned into exactly one texture object no matter how many materials, models or
+ * scene functions reference it. The first request for a path also submits its preparation to the
+ * TaskGraph, so it overlaps with OBJ parsing, BVH construction and photon emission: paged images
+ * get their tiled file checked (or converted), and their tiles are only read when first sampled;
+ * unpaged images are decoded in full. Lookups never wait for the graph: a texture that is
+ * sampled before its task ran simply prepares itself on the spot.
+ */
+class TextureRegistry {
+public:
+    static TextureRegistry& instance() {
+        static TextureRegistry registry;
+        return registry;
+    }
+
+    ~TextureRegistry() { wait(); }
+
+    /**
+     * @brief Return the shared texture for 'filename', creating it and scheduling its preparation on first use.
+     */
+    std::shared_ptr<Texture> get(const std::string& filename) {
+        std::string key = canonical_key(filename);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        ++requests;
+        auto it = textures.find(key);
+        if (it != textures.end()) return it->second;
+
+        auto texture = std::make_shared<TiledImageTexture>(filename, texture_cache_enabled());
+        textures.emplace(key, texture);
+        lock.unlock();
+
+        TaskHandle task = TaskGraph::instance().submit([this, texture] { prepare(*texture); });
+        lock.lock();
+        pending.push_back(std::move(task));
+        return texture;
+    }
+
+    /**
+     * @brief Block until every texture requested so far has been prepared, and report the totals.
+     */
+    void wait() {
+        std::vector<TaskHandle> tasks;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (pending.empty()) return;
+            tasks.swap(pending);
+        }
+        for (const auto& task : tasks) TaskGraph::instance().wait(task);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        std::cout << "[TextureRegistry] " << textures.size() << " unique images for " << requests
+                  << " references, prepared in " << prepare_seconds << "s (thread time)." << std::endl;
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return textures.size();
+    }
+
+private:
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, std::shared_ptr<TiledImageTexture>> textures;
+    std::vector<TaskHandle> pending; // Preparation tasks not waited for yet
+    size_t requests = 0;
+    double prepare_seconds = 0.0;
+
+    // The graph must outlive the registry, whose destructor still waits on it
+    TextureRegistry() { TaskGraph::instance(); }
+
+    /**
+     * @brief Resolve "./a/../b.png" and "b.png" to the same key; falls back to the lexical form
+     * for paths that cannot be resolved (the texture then reports the load error itself).
+     */
+    static std::string canonical_key(const std::string& filename) {
+        std::error_code ec;
+        std::filesystem::path path = std::filesystem::weakly_canonical(filename, ec);
+        if (ec) path = std::filesystem::path(filename).lexically_normal();
+        return path.string();
+    }
+
+    void prepare(const TiledImageTexture& texture) {
+        auto start = std::chrono::steady_clock::now();
+        texture.prepare();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        prepare_seconds += elapsed.count();
+    }
+};
+
+/**
+ * @brief Get the texture for an image file through the registry: tiled and lazily paged when the
+ * texture cache is enabled, otherwise fully decoded into memory. Repeated paths share one texture.
+ */
+inline std::shared_ptr<Texture> load_image_texture(const std::string& filename) {
+    return TextureRegistry::instance().get(filename);
+}
@@ -1,13 +1,23 @@
 #pragma once
 #include <glm/glm.hpp>
+#include <cstdint>
 #include <string>
 
+/**
+ * @brief Tag of the concrete texture class, used by texture_value() to dispatch without virtual calls.
+ * Textures defined outside the closed set keep 'Other' and go through the virtual interface.
+ */
+enum class TextureKind : uint8_t { Other, SolidColor, Checker, Image, TiledImage, Perlin };
+
 /**
  * @brief Abstract base class for textures.
  * A texture maps a point in 2D (u,v) or 3D (p) space to a color value.
  */
 class Texture {
 public:
+    const TextureKind kind;
+
+    explicit Texture(TextureKind kind = TextureKind::Other) : kind(kind) {}
     virtual ~Texture() = default;
 
     /**
@@ -19,4 +29,14 @@ public:
      * @return glm::vec3 The color value (radiance/albedo).
      */
     virtual glm::vec3 value(float u, float v, const glm::vec3& p) const = 0;
+
+    /**
+     * @brief Samples the color filtered over a footprint (used for MIP level selection).
+     * Textures without prefiltered data ignore the footprint.
+     * 
+     * @param uv_width Approximate width of the ray footprint in UV units (0 = unfiltered).
+     */
+    virtual glm::vec3 value(float u, float v, const glm::vec3& p, float uv_width) const {
+        return value(u, v, p);
+    }
 };
\ No newline at end of file